@@ -34,6 +34,12 @@ std::string map_section_to_text(std::string &section) {
         sectionDisplay = "NSGuiLogListItemText"_tr;
     } else if (sectionDisplay == "stats") {
         sectionDisplay = "StatsGuiLogListItemText"_tr;
+    } else if (sectionDisplay == "engine") {
+        sectionDisplay = "EngineGuiLogListItemText"_tr;
+    } else if (sectionDisplay == "done") {
+        sectionDisplay = "DoneGuiLogListItemText"_tr;
+    } else if (sectionDisplay == "debug_us") {
+        sectionDisplay = "DebugUsGuiLogListItemText"_tr;
     }
     return sectionDisplay;
 }
@@ -60,6 +66,8 @@ std::string map_stats_to_text(const char *stat) {
         statDisplay = "HeapSizeGuiLogListItemText"_tr;
     } else if (statDisplay == "buffer_size") {
         statDisplay = "BufferSizeGuiLogListItemText"_tr;
+    } else if (statDisplay == "workers") {
+        statDisplay = "WorkersGuiLogListItemText"_tr;
     } else if (statDisplay == "patch_time") {
         statDisplay = "Patch_timeGuiLogListItemText"_tr;
     }
@@ -360,8 +368,15 @@ public:
                     user->list->addItem(new ColouredListItem(Key, "UnPatchedGuiLogListItemText"_tr, colour_unpatched));
                 } else if (status.starts_with("Disabled")) {
                     user->list->addItem(new ColouredListItem(Key, "DisabledGuiLogListItemText"_tr, colour_unpatched));
+                } else if (status.starts_with("Timed out")) {
+                    // followed by how long the title was worked on, eg " (1.000s)"
+                    user->list->addItem(new ColouredListItem(Key, "TimedOutGuiLogListItemText"_tr + status.substr(std::string_view{"Timed out"}.size()), colour_unpatched));
                 } else if (user->last_section == "stats") {
                     user->list->addItem(new ColouredListItem(map_stats_to_text(Key), Value, tsl::style::color::ColorDescription));
+                } else if (user->last_section == "engine" || user->last_section == "done" || user->last_section == "debug_us") {
+                    // one entry per title
+                    std::string title{Key};
+                    user->list->addItem(new ColouredListItem(map_section_to_text(title), Value, tsl::style::color::ColorDescription));
                 } else {
                     user->list->addItem(new ColouredListItem(Key, Value, tsl::style::color::ColorText));
                 }
@@ -428,6 +443,7 @@ public:
                 "PatchedGuiLogListItemText": "Patched",
                 "UnPatchedGuiLogListItemText": "Unpatched",
                 "DisabledGuiLogListItemText": "Disabled",
+                "TimedOutGuiLogListItemText": "Timed out",
                 "FsGuiLogListItemText": "File Signature",
                 "LdrGuiLogListItemText": "Module Loader",
                 "ErptGuiLogListItemText": "Error Report",
@@ -438,6 +454,9 @@ public:
                 "AmGuiLogListItemText": "Application Manager",
                 "NSGuiLogListItemText": "NS Sysmodule",
                 "StatsGuiLogListItemText": "Statistics",
+                "EngineGuiLogListItemText": "Scan Engine",
+                "DoneGuiLogListItemText": "Time Until Done",
+                "DebugUsGuiLogListItemText": "Time Paused (us)",
                 "VersionGuiLogListItemText": "Version",
                 "BuildDateGuiLogListItemText": "Build Date",
                 "FWVersionGuiLogListItemText": "System Firmware Version",
@@ -448,6 +467,7 @@ public:
                 "IsEmummcGuiLogListItemText": "Is EmuMMC",
                 "HeapSizeGuiLogListItemText": "Heap Size",
                 "BufferSizeGuiLogListItemText": "Buffer Size",
+                "WorkersGuiLogListItemText": "Worker Threads",
                 "Patch_timeGuiLogListItemText": "Patch Application Time",
                 "NoLogFoundGuiLogListItemText": "No Logs Found!",
                 "OptionsGuiMainListItemText": "Options",
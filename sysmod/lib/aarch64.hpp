@@ -0,0 +1,312 @@
+#pragma once
+
+// single pass aarch64 decoder that builds an index of branches and data references
+// (adr, adrp + add / ldr) over a text segment. it doesn't depend on libnx, so it can
+// be built and run on a host against a raw code blob. nothing in the sys-module uses it
+// yet, which is why it lives outside of src/, only sysmod/tests builds it for now.
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <optional>
+#include <algorithm>
+
+namespace aarch64 {
+
+using u8 = std::uint8_t;
+using u32 = std::uint32_t;
+using u64 = std::uint64_t;
+using s64 = std::int64_t;
+
+enum class BranchKind : u8 {
+    Call, // bl
+    Jump, // b
+    Conditional, // b.cond, cbz, cbnz, tbz, tbnz
+};
+
+// addresses are kept whole, a target may lie below the text or far past its end.
+struct Branch {
+    u64 from; // address of the instruction
+    u64 to; // address of the target
+    BranchKind kind;
+};
+
+struct DataRef {
+    u64 from; // address of the instruction that completes the address (adr, add or ldr)
+    u64 to; // address formed
+};
+
+constexpr auto sign_extend(u64 v, u32 bits) -> s64 {
+    const auto m = u64(1) << (bits - 1);
+    return static_cast<s64>((v ^ m) - m);
+}
+
+// target of a pc relative branch, if inst is one.
+constexpr auto decode_branch(u64 pc, u32 inst) -> std::optional<Branch> {
+    s64 imm{};
+    BranchKind kind{};
+    if ((inst & 0x7C000000) == 0x14000000) { // b, bl
+        imm = sign_extend(inst & 0x03FFFFFF, 26) * 4;
+        kind = inst >> 31 ? BranchKind::Call : BranchKind::Jump;
+    } else if ((inst & 0xFF000010) == 0x54000000 || (inst & 0x7E000000) == 0x34000000) { // b.cond, cbz, cbnz
+        imm = sign_extend((inst >> 5) & 0x7FFFF, 19) * 4;
+        kind = BranchKind::Conditional;
+    } else if ((inst & 0x7E000000) == 0x36000000) { // tbz, tbnz
+        imm = sign_extend((inst >> 5) & 0x3FFF, 14) * 4;
+        kind = BranchKind::Conditional;
+    } else {
+        return std::nullopt;
+    }
+    return Branch{ pc, pc + imm, kind };
+}
+
+// address formed by adr, if inst is one.
+constexpr auto decode_adr(u64 pc, u32 inst) -> std::optional<u64> {
+    if ((inst & 0x9F000000) != 0x10000000) {
+        return std::nullopt;
+    }
+    const u64 imm = ((inst >> 5) & 0x7FFFF) << 2 | ((inst >> 29) & 3);
+    return pc + sign_extend(imm, 21);
+}
+
+// page formed by adrp, if inst is one.
+constexpr auto decode_adrp(u64 pc, u32 inst) -> std::optional<u64> {
+    if ((inst & 0x9F000000) != 0x90000000) {
+        return std::nullopt;
+    }
+    const u64 imm = ((inst >> 5) & 0x7FFFF) << 2 | ((inst >> 29) & 3);
+    return (pc & ~u64(0xFFF)) + (sign_extend(imm, 21) << 12);
+}
+
+// general purpose registers inst writes, one bit per register. register 31 is sp or zr,
+// which never hold a page. an instruction that might write a register is taken to, so that
+// a page is never paired with an add or ldr after the register has been overwritten.
+constexpr auto written_registers(u32 inst) -> u32 {
+    const u32 rd = inst & 0x1F; // also rt
+    const u32 rn = (inst >> 5) & 0x1F;
+    const u32 rt2 = (inst >> 10) & 0x1F;
+    const u32 rs = (inst >> 16) & 0x1F;
+    const bool simd = inst & 0x04000000;
+
+    if ((inst & 0xFC000000) == 0x94000000 || (inst & 0xFFFFFC1F) == 0xD63F0000) { // bl, blr
+        return 0x4007FFFF; // the call may use x0-x18 freely, and sets x30
+    }
+    if ((inst & 0xFFE0001F) == 0xD4000001) { // svc
+        return 0xFF; // results come back in x0-x7
+    }
+    if ((inst & 0x1C000000) == 0x10000000 || (inst & 0x0E000000) == 0x0A000000) { // data processing
+        return 1U << rd;
+    }
+    if ((inst & 0xFFF00000) == 0xD5300000) { // mrs
+        return 1U << rd;
+    }
+    if ((inst & 0x5F20FC00) == 0x1E200000 || (inst & 0xBFE0EC00) == 0x0E002C00) { // fp <-> int, umov, smov
+        return 1U << rd;
+    }
+    if ((inst & 0x0A000000) != 0x08000000) { // anything else but loads and stores
+        return 0;
+    }
+
+    if ((inst & 0x3F000000) == 0x08000000) { // exclusive, acquire / release, cas
+        return 1U << rd | 1U << rt2 | 1U << rs;
+    }
+    if ((inst & 0x3B000000) == 0x18000000) { // ldr literal
+        return simd ? 0 : 1U << rd;
+    }
+    if ((inst & 0x3A000000) == 0x28000000) { // ldp, stp
+        const bool load = inst & 0x00400000;
+        const bool writeback = inst & 0x00800000; // post or pre indexed
+        return (load && !simd ? 1U << rd | 1U << rt2 : 0) | (writeback ? 1U << rn : 0);
+    }
+    if ((inst & 0x3B000000) == 0x39000000 || (inst & 0x3F000000) == 0x19000000) { // unsigned offset, ldapur / stlur
+        return (inst & 0x00C00000) && !simd ? 1U << rd : 0;
+    }
+    if ((inst & 0x3B000000) == 0x38000000) {
+        const u32 op = (inst >> 10) & 3;
+        if (inst & 0x00200000) {
+            if (op == 2) { // ldr, str with a register offset
+                return (inst & 0x00C00000) && !simd ? 1U << rd : 0;
+            }
+            return (simd ? 0 : 1U << rd) | (op == 3 ? 1U << rn : 0); // atomics, ldraa / ldrab
+        }
+        // unscaled, post and pre indexed, unprivileged
+        return ((inst & 0x00C00000) && !simd ? 1U << rd : 0) | (op & 1 ? 1U << rn : 0);
+    }
+    if ((inst & 0xBE800000) == 0x0C800000) { // ld1 / st1 and the like, post indexed
+        return 1U << rn;
+    }
+    return 0;
+}
+
+// streaming decoder, call feed() with consecutive chunks of the text. it keeps the page of
+// every register set by adrp for a few instructions, so pairs that straddle chunks are found.
+template<typename OnBranch, typename OnRef>
+struct Decoder {
+    // an adrp is only paired with an add / ldr this many instructions after it.
+    static constexpr u32 PAIR_WINDOW = 16;
+
+    constexpr Decoder(OnBranch on_branch, OnRef on_ref)
+    : on_branch{on_branch}, on_ref{on_ref} {}
+
+    // data holds whole instructions starting at addr, addr has to be 4 byte aligned.
+    void feed(const u8* data, u32 size, u64 addr) {
+        for (u32 i = 0; i + 4 <= size; i += 4) {
+            u32 inst;
+            std::memcpy(&inst, data + i, sizeof(inst));
+            step(addr + i, inst);
+        }
+    }
+
+    constexpr void step(u64 pc, u32 inst) {
+        n++;
+
+        if (auto b = decode_branch(pc, inst)) {
+            on_branch(*b);
+        } else if (auto a = decode_adr(pc, inst)) {
+            on_ref(DataRef{ pc, *a });
+        } else if ((inst & 0xFFC00000) == 0x91000000) { // add xd, xn, #imm12
+            const u32 rn = (inst >> 5) & 0x1F;
+            if (paired(rn)) {
+                on_ref(DataRef{ pc, page[rn] + ((inst >> 10) & 0xFFF) });
+            }
+        } else if ((inst & 0xBFC00000) == 0xB9400000) { // ldr wt / xt, [xn, #imm12]
+            const u32 rn = (inst >> 5) & 0x1F;
+            const u32 scale = 2 + (inst >> 30 & 1);
+            if (paired(rn)) {
+                on_ref(DataRef{ pc, page[rn] + (u64((inst >> 10) & 0xFFF) << scale) });
+            }
+        }
+
+        // every register written no longer holds a page, other than the one adrp sets.
+        for (auto written = written_registers(inst); written; written &= written - 1) {
+            page_at[std::countr_zero(written)] = 0;
+        }
+        if (auto p = decode_adrp(pc, inst)) {
+            page[inst & 0x1F] = *p;
+            page_at[inst & 0x1F] = n;
+        }
+    }
+
+private:
+    constexpr auto paired(u32 reg) const -> bool {
+        return page_at[reg] && n - page_at[reg] <= PAIR_WINDOW;
+    }
+
+    OnBranch on_branch;
+    OnRef on_ref;
+    u64 page[32]{};
+    u64 page_at[32]{}; // instruction count at the adrp, 0 if the register holds no page
+    u64 n{};
+};
+
+// index of every branch and data reference of a text segment, kept in storage supplied by
+// the caller. once it is full, further entries are dropped and overflowed() returns true.
+// entries are in address order, as long as the text is fed in order.
+struct Index {
+    Index(std::span<Branch> branches, std::span<DataRef> refs, std::span<u64> functions = {})
+    : branch_storage{branches}, ref_storage{refs}, function_storage{functions} {}
+
+    // the decoder points back at the index.
+    Index(const Index&) = delete;
+    auto operator=(const Index&) -> Index& = delete;
+
+    // decodes size bytes of text at addr, see Decoder::feed().
+    void feed(const u8* data, u32 size, u64 addr) {
+        decoder.feed(data, size, addr);
+    }
+
+    // collects the targets of every call as the function starts, sorted and unique.
+    // only needed for function_containing().
+    void finish() {
+        num_functions = 0;
+        for (u32 i = 0; i < num_branches; i++) {
+            if (branch_storage[i].kind == BranchKind::Call) {
+                if (num_functions == function_storage.size()) {
+                    overflow = true;
+                    break;
+                }
+                function_storage[num_functions++] = branch_storage[i].to;
+            }
+        }
+        std::sort(function_storage.begin(), function_storage.begin() + num_functions);
+        num_functions = static_cast<u32>(std::unique(function_storage.begin(), function_storage.begin() + num_functions) - function_storage.begin());
+    }
+
+    auto branches() const -> std::span<const Branch> { return branch_storage.first(num_branches); }
+    auto refs() const -> std::span<const DataRef> { return ref_storage.first(num_refs); }
+    auto overflowed() const -> bool { return overflow; }
+
+    // call sites of the function at target. returns the number found, only the first
+    // out.size() are written.
+    auto callers_of(u64 target, std::span<u64> out) const -> u32 {
+        u32 count{};
+        for (const auto& b : branches()) {
+            if (b.kind == BranchKind::Call && b.to == target) {
+                if (count < out.size()) {
+                    out[count] = b.from;
+                }
+                count++;
+            }
+        }
+        return count;
+    }
+
+    // instructions that form the address target. same return as callers_of().
+    auto refs_to(u64 target, std::span<u64> out) const -> u32 {
+        u32 count{};
+        for (const auto& r : refs()) {
+            if (r.to == target) {
+                if (count < out.size()) {
+                    out[count] = r.from;
+                }
+                count++;
+            }
+        }
+        return count;
+    }
+
+    // start of the function holding addr, that is the closest call target at or below it.
+    auto function_containing(u64 addr) const -> std::optional<u64> {
+        const auto functions = function_storage.first(num_functions);
+        const auto it = std::upper_bound(functions.begin(), functions.end(), addr);
+        if (it == functions.begin()) {
+            return std::nullopt;
+        }
+        return *(it - 1);
+    }
+
+private:
+    struct AddBranch {
+        Index* index;
+        void operator()(const Branch& b) const {
+            if (index->num_branches == index->branch_storage.size()) {
+                index->overflow = true;
+            } else {
+                index->branch_storage[index->num_branches++] = b;
+            }
+        }
+    };
+
+    struct AddRef {
+        Index* index;
+        void operator()(const DataRef& r) const {
+            if (index->num_refs == index->ref_storage.size()) {
+                index->overflow = true;
+            } else {
+                index->ref_storage[index->num_refs++] = r;
+            }
+        }
+    };
+
+    std::span<Branch> branch_storage;
+    std::span<DataRef> ref_storage;
+    std::span<u64> function_storage;
+    u32 num_branches{};
+    u32 num_refs{};
+    u32 num_functions{};
+    bool overflow{};
+    Decoder<AddBranch, AddRef> decoder{ AddBranch{ this }, AddRef{ this } };
+};
+
+} // namespace aarch64
@@ -1,17 +1,35 @@
 #include <cstring>
 #include <span>
+#include <array>
 #include <algorithm> // for std::min
 #include <bit> // for std::byteswap
+#include <type_traits>
 #include <utility> // std::unreachable
+#include <initializer_list>
+#include <atomic>
+#include <new> // placement new
 #include <switch.h>
 #include "minIni/minIni.h"
 
+#if defined(__ARM_NEON)
+    #include <arm_neon.h>
+#elif defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
 namespace {
 
 constexpr u64 INNER_HEAP_SIZE = 0x1000; // Size of the inner heap (adjust as necessary).
-constexpr u64 READ_BUFFER_SIZE = 0x1000; // size of static buffer which memory is read into
+constexpr u64 READ_BUFFER_SIZE = 0x1000; // default size of each read, also the chunk engines are timed on
+constexpr u32 MAX_READ_SIZE = 0x4000; // read_size is capped to this
+constexpr s32 READ_AHEAD_CORE = 2; // next to the main thread on core 3, a worker may share the core with the reader
+constexpr s32 READ_AHEAD_PRIORITY = 49; // same as main_thread_priority
+constexpr u32 MAX_CORES = 4;
+constexpr u32 MAX_TITLES_PER_THREAD = 4; // titles_per_thread is capped to this
+constexpr u64 MAPPED_SLICE = 0x10000; // bytes of a mapped region scanned per step
 constexpr u32 FW_VER_ANY = 0x0;
-constexpr u16 REGEX_SKIP = 0x100;
+constexpr u32 MAX_PATTERN_SIZE = 0xFF; // pattern and patch sizes are stored as a u8
+constexpr u32 VECTOR_SIZE = 32; // widest compare, data is read up to this far past the end of a pattern
 
 u32 FW_VERSION{}; // set on startup
 u32 AMS_VERSION{}; // set on startup
@@ -19,43 +37,565 @@ u32 AMS_TARGET_VERSION{}; // set on startup
 u8 AMS_KEYGEN{}; // set on startup
 u64 AMS_HASH{}; // set on startup
 bool VERSION_SKIP{}; // set on startup
+bool ENGINE_CROSS_CHECK{}; // set on startup
+bool MAP_MEMORY{}; // set on startup
+bool SHORT_DEBUG{}; // set on startup
+bool READ_AHEAD{}; // set on startup
+u32 READ_SIZE{READ_BUFFER_SIZE}; // set on startup
+u32 WORKER_CORES{}; // set on startup, one bit per core that titles are patched on
+s32 WORKER_PRIORITY{}; // set on startup
+u32 TITLES_PER_THREAD{1}; // set on startup
+u64 TITLE_BUDGET{}; // set on startup, ticks a title may take, 0 for no limit
+u64 DEADLINE_TICK{}; // set on startup, tick by which every title has to be done, 0 for no limit
+bool LDR_DMNT{}; // set on startup, if the loader's module list can be used
+
+// invalid string will cause a compile-time error due to no return
+constexpr auto hexstr_2_nibble(char c) -> u8 {
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= '0' && c <= '9') { return c - '0'; }
+}
 
-template<typename T>
-constexpr void str2hex(const char* s, T* data, u8& size) {
-    // skip leading 0x (if any)
+// skip leading 0x (if any)
+constexpr auto skip_hex_prefix(const char* s) -> const char* {
     if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
         s += 2;
     }
+    return s;
+}
 
-    // invalid string will cause a compile-time error due to no return
-    constexpr auto hexstr_2_nibble = [](char c) -> u8 {
-        if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
-        if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
-        if (c >= '0' && c <= '9') { return c - '0'; }
-    };
+constexpr void str2hex(const char* s, u8* data, u8& size) {
+    s = skip_hex_prefix(s);
 
     // parse and convert string
     while (*s != '\0') {
-        if (sizeof(T) == sizeof(u16) && *s == '.') {
-            data[size] = REGEX_SKIP;
-            s += 2; // consume both dots of ".."
-        } else {
-            data[size] |= hexstr_2_nibble(*s++) << 4;
-            data[size] |= hexstr_2_nibble(*s++) << 0;
-        }
+        data[size] |= hexstr_2_nibble(*s++) << 4;
+        data[size] |= hexstr_2_nibble(*s++) << 0;
         size++;
     }
 }
 
+// rough information content (in bits) of each byte value in aarch64 code, higher is rarer.
+// instructions are little endian, so opcode top bytes, register fields and small
+// immediates (0x00 / 0xFF) are over-represented, anything not listed is treated as uniform.
+constexpr auto make_byte_rarity() {
+    constexpr u8 very_common[] = {
+        0x00, 0xFF, 0x03, 0x1F, 0x40, 0xE0, 0xF9, 0xAA, 0x91, 0x94, 0x97,
+    };
+    constexpr u8 common[] = {
+        0x01, 0x02, 0x08, 0x13, 0x14, 0x17, 0x2A, 0x34, 0x35, 0x36, 0x39, 0x43, 0x52, 0x54, 0x5F, 0x6B,
+        0x71, 0x72, 0x7B, 0x80, 0x83, 0x8B, 0xA9, 0xB4, 0xB5, 0xB9, 0xC0, 0xD1, 0xD6, 0xE1, 0xE2, 0xE8,
+        0xEB, 0xF1, 0xF3, 0xF4, 0xF5, 0xFD,
+    };
+
+    std::array<u8, 256> rarity{};
+    for (auto& r : rarity) { r = 8; }
+    for (auto b : common) { rarity[b] = 5; }
+    for (auto b : very_common) { rarity[b] = 3; }
+    return rarity;
+}
+
+constexpr auto BYTE_RARITY = make_byte_rarity();
+
+// anchor bytes rarer than this are searched for with memchr, for anything more
+// common it stops so often that stepping over aligned words is faster.
+constexpr u8 MEMCHR_MIN_RARITY = 5;
+
+// called where a table can't be made, with what is wrong. it isn't constexpr, so reaching
+// it during constant evaluation fails the build, and the error shows the call.
+void constexpr_fail(const char*) {}
+
+// a run of non-wildcard bytes within a pattern.
+struct LiteralRun {
+    u8 offset{};
+    u8 size{};
+};
+
+constexpr u32 MAX_PATTERN_PARTS = 4;
+constexpr u32 MAX_BYTE_CLASSES = 8;
+constexpr u32 MAX_CLASS_OPTIONS = 8;
+
+// bytes of a pattern that are compared at a single offset. every part after the
+// first follows a gap of between gap_min and gap_max bytes of anything.
+struct PatternPart {
+    u8 offset{}; // of the first byte of the part within the pattern
+    u8 size{};
+    u8 gap_min{};
+    u8 gap_max{};
+};
+
+// a byte that has to be one of a few values. the pattern itself only holds the bits
+// that all options agree on, the class is only kept if those alone aren't exact.
+struct ByteClass {
+    u8 offset{}; // of the byte within the pattern
+    u8 count{};
+    u8 options[MAX_CLASS_OPTIONS]{};
+};
+
+// a pattern as parsed from its string, only used at compile time.
+// at runtime patterns are read from a PatternArena.
+//
+//   A8       byte that has to match
+//   ..       any byte
+//   A. .8    byte of which only one nibble has to match
+//   [A8|A9]  byte that has to be one of the options
+//   {4}      4 bytes of anything, same as ........
+//   {0-8}    between 0 and 8 bytes of anything
 struct PatternData {
+    constexpr PatternData() = default;
+
     constexpr PatternData(const char* s) {
-        str2hex(s, data, size);
+        s = skip_hex_prefix(s);
+
+        while (*s != '\0') {
+            if (*s == '[') {
+                s = parse_class(s + 1);
+            } else if (*s == '{') {
+                s = parse_gap(s + 1);
+            } else {
+                u8 v{}, m{};
+                for (u32 shift : { 4, 0 }) {
+                    if (*s != '.') {
+                        v |= hexstr_2_nibble(*s) << shift;
+                        m |= 0xF << shift;
+                    }
+                    s++;
+                }
+                push(v, m);
+            }
+        }
+
+        size = parts[0].size;
+        if (!find_anchor()) {
+            constexpr_fail("a pattern needs at least one byte that isn't a wildcard");
+        }
+    }
+
+    // bytes from the start of the pattern to the end of its last part, with every gap at its longest.
+    constexpr auto extent() const -> u32 {
+        u32 n = size;
+        for (u32 i = 1; i < num_parts; i++) {
+            n += parts[i].gap_max + parts[i].size;
+        }
+        return n;
+    }
+
+    // bytes held in value and mask, the parts are stored back to back.
+    constexpr auto total() const -> u32 {
+        return parts[num_parts - 1].offset + parts[num_parts - 1].size;
+    }
+
+    // picks the most selective literal run (by BYTE_RARITY) of the first part as the anchor
+    // that the scanners search for, along with the rarest byte within it.
+    // returns false if there is no literal byte to anchor on.
+    constexpr auto find_anchor() -> bool {
+        u32 best_score{};
+        anchor = {};
+        for (u8 i = 0; i < size;) {
+            if (mask[i] != 0xFF) {
+                i++;
+                continue;
+            }
+
+            u32 score{};
+            u8 end = i;
+            for (; end < size && mask[end] == 0xFF; end++) {
+                score += BYTE_RARITY[value[end]];
+            }
+            if (score > best_score) {
+                best_score = score;
+                anchor = { i, static_cast<u8>(end - i) };
+            }
+            i = end;
+        }
+
+        anchor_byte = anchor.offset;
+        for (u8 i = anchor.offset; i < anchor.offset + anchor.size; i++) {
+            if (BYTE_RARITY[value[i]] > BYTE_RARITY[value[anchor_byte]]) {
+                anchor_byte = i;
+            }
+        }
+        return anchor.size;
+    }
+
+    u8 value[MAX_PATTERN_SIZE]{};
+    u8 mask[MAX_PATTERN_SIZE]{}; // bits of each byte that have to match
+    u8 size{}; // bytes of the first part, everything before the first gap
+    PatternPart parts[MAX_PATTERN_PARTS]{};
+    u8 num_parts{1};
+    ByteClass classes[MAX_BYTE_CLASSES]{};
+    u8 num_classes{};
+    LiteralRun anchor{}; // most selective literal run
+    u8 anchor_byte{}; // offset of the rarest byte within the anchor
+
+private:
+    constexpr void push(u8 v, u8 m) {
+        auto& part = parts[num_parts - 1];
+        const u32 i = part.offset + part.size;
+        if (i >= MAX_PATTERN_SIZE) {
+            constexpr_fail("a pattern is longer than MAX_PATTERN_SIZE");
+        }
+        value[i] = v;
+        mask[i] = m;
+        part.size++;
+    }
+
+    static constexpr auto parse_number(const char*& s) -> u32 {
+        if (*s < '0' || *s > '9') {
+            constexpr_fail("a gap needs a number, as in {4} or {2-6}");
+        }
+        u32 n{};
+        for (; *s >= '0' && *s <= '9'; s++) {
+            n = n * 10 + (*s - '0');
+        }
+        return n;
+    }
+
+    // {n} or {min-max}, s points past the brace.
+    constexpr auto parse_gap(const char* s) -> const char* {
+        const u32 min = parse_number(s);
+        u32 max = min;
+        if (*s == '-') {
+            max = parse_number(++s);
+        }
+        if (*s++ != '}' || max < min || max > 0xFF) {
+            constexpr_fail("a gap has to end with }, with min <= max <= 255");
+        }
+
+        if (min == max) {
+            for (u32 i = 0; i < min; i++) {
+                push(0, 0);
+            }
+        } else {
+            if (num_parts == MAX_PATTERN_PARTS) {
+                constexpr_fail("a pattern has more than MAX_PATTERN_PARTS variable gaps");
+            }
+            const auto& last = parts[num_parts - 1];
+            parts[num_parts++] = { static_cast<u8>(last.offset + last.size), 0, static_cast<u8>(min), static_cast<u8>(max) };
+        }
+        return s;
+    }
+
+    // [A8|A9|...], s points past the bracket.
+    constexpr auto parse_class(const char* s) -> const char* {
+        ByteClass c{ static_cast<u8>(total()) };
+        u8 all_and = 0xFF, all_or = 0;
+        do {
+            if (c.count == MAX_CLASS_OPTIONS) {
+                constexpr_fail("a byte class has more than MAX_CLASS_OPTIONS options");
+            }
+            const u8 b = hexstr_2_nibble(s[0]) << 4 | hexstr_2_nibble(s[1]);
+            s += 2;
+
+            bool seen{};
+            for (u32 i = 0; i < c.count; i++) {
+                seen |= c.options[i] == b;
+            }
+            if (!seen) {
+                c.options[c.count++] = b;
+                all_and &= b;
+                all_or |= b;
+            }
+        } while (*s == '|' && s++);
+
+        if (*s++ != ']') {
+            constexpr_fail("a byte class has to end with ]");
+        }
+
+        // bits that every option agrees on, if exactly as many bytes match those
+        // as there are options, the mask alone is exact and the class isn't needed.
+        const u8 m = ~(all_and ^ all_or);
+        u32 matching{};
+        for (u32 b = 0; b < 256; b++) {
+            matching += (b & m) == all_and;
+        }
+        if (matching != c.count) {
+            if (num_classes == MAX_BYTE_CLASSES) {
+                constexpr_fail("a pattern has more than MAX_BYTE_CLASSES byte classes");
+            }
+            classes[num_classes++] = c;
+        }
+
+        push(all_and, m);
+        return s;
     }
+};
 
-    u16 data[60]{}; // reasonable max pattern length, adjust as needed
+// location of a pattern within its title's arena. the arena holds the value of every byte
+// of the first part (0 for wildcards), followed by two bits per byte that are set if the
+// low / high nibble of the byte has to match.
+struct PatternRef {
+    u16 offset{};
     u8 size{};
+    u8 anchor_byte{}; // offset of the rarest byte within the anchor
+    u8 anchor_value{}; // value of that byte
+};
+
+constexpr auto packed_size(u32 size) -> u32 {
+    return size + (size * 2 + 7) / 8;
+}
+
+template<typename T = u64>
+inline auto load(const u8* p) -> T {
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// expands the low 16 mask bits into 8 bytes, a nibble of 0xF for every set bit.
+constexpr auto expand_mask(u64 bits) -> u64 {
+    auto x = bits & 0xFFFF;
+    // halve the distance between the bits until every one sits at the bottom of its nibble
+    x = (x | x << 24) & 0x000000FF000000FFULL;
+    x = (x | x << 12) & 0x000F000F000F000FULL;
+    x = (x | x << 6) & 0x0303030303030303ULL;
+    x = (x | x << 3) & 0x1111111111111111ULL;
+    return x * 0xF;
+}
+
+// mask bits of the sizeof(T) * 4 bytes of a pattern starting at i, bits past the end
+// of the pattern are cleared as they belong to whatever follows it in the arena.
+template<typename T>
+inline auto mask_bits(const u8* bits, u32 i, u32 size) -> T {
+    auto m = load<T>(bits + i / 4);
+    if ((size - i) * 2 < sizeof(T) * 8) {
+        m &= static_cast<T>((T{1} << ((size - i) * 2)) - 1);
+    }
+    return m;
+}
+
+// swar compare of the pattern 8 bytes at a time, starting with the word that holds
+// the anchor byte as that is the most likely to reject a mismatch.
+// same read requirements as pattern_matches().
+inline auto pattern_words_match(const u8* data, const u8* arena, PatternRef p) -> bool {
+    const auto value = arena + p.offset;
+    const auto bits = value + p.size;
+    const u32 words = (p.size + 7) / 8;
+    const u32 first = p.anchor_byte / 8;
+    for (u32 n = 0; n < words; n++) {
+        const u32 w = first + n < words ? first + n : first + n - words;
+        if ((load(data + w * 8) ^ load(value + w * 8)) & expand_mask(mask_bits<u16>(bits, w * 8, p.size))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// compares the pattern against data, 16 / 32 bytes at a time when simd is available.
+// compares are done in whole vectors, so data and the arena must be readable up to
+// the pattern size rounded up to the vector width (at most VECTOR_SIZE bytes past the end).
+inline auto pattern_matches(const u8* data, const u8* arena, PatternRef p) -> bool {
+#if defined(__ARM_NEON)
+    const auto value = arena + p.offset;
+    const auto bits = value + p.size;
+    for (u32 i = 0; i < p.size; i += 16) {
+        const auto m = mask_bits<u32>(bits, i, p.size);
+        const auto mask = vcombine_u8(vcreate_u8(expand_mask(m)), vcreate_u8(expand_mask(m >> 16)));
+        const auto diff = vandq_u8(veorq_u8(vld1q_u8(data + i), vld1q_u8(value + i)), mask);
+        if (vmaxvq_u8(diff)) {
+            return false;
+        }
+    }
+    return true;
+#elif defined(__AVX2__)
+    const auto value = arena + p.offset;
+    const auto bits = value + p.size;
+    for (u32 i = 0; i < p.size; i += 32) {
+        const auto m = mask_bits<u64>(bits, i, p.size);
+        const auto mask = _mm256_set_epi64x(expand_mask(m >> 48), expand_mask(m >> 32), expand_mask(m >> 16), expand_mask(m));
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const auto expected = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(value + i));
+        const auto diff = _mm256_and_si256(_mm256_xor_si256(v, expected), mask);
+        if (!_mm256_testz_si256(diff, diff)) {
+            return false;
+        }
+    }
+    return true;
+#elif defined(__SSE2__)
+    const auto value = arena + p.offset;
+    const auto bits = value + p.size;
+    for (u32 i = 0; i < p.size; i += 16) {
+        const auto m = mask_bits<u32>(bits, i, p.size);
+        const auto mask = _mm_set_epi64x(expand_mask(m >> 16), expand_mask(m));
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const auto expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + i));
+        const auto diff = _mm_and_si128(_mm_xor_si128(v, expected), mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF) {
+            return false;
+        }
+    }
+    return true;
+#else
+    return pattern_words_match(data, arena, p);
+#endif
+}
+
+// aarch64 instructions are always 4 byte aligned, so a pattern can only ever
+// match at the one alignment phase that puts its inst_offset on an instruction.
+constexpr auto is_inst_aligned(u64 pattern_addr, s32 inst_offset) -> bool {
+    return !((pattern_addr + inst_offset) & 3);
+}
+
+// first index in the chunk at which a pattern starting there has its instruction aligned.
+constexpr auto first_aligned_index(u64 addr, s32 inst_offset) -> u32 {
+    return (0 - (addr + inst_offset)) & 3;
+}
+
+// up to 8 literal bytes of a pattern that are compared with a single load.
+struct PatternSegment {
+    u8 offset;
+    u8 width; // 1, 2, 4 or 8
+    u64 value;
+    u64 mask;
+};
+
+// past this many loads, the generic vector compare is both smaller and faster.
+constexpr u32 MAX_UNROLLED_SEGMENTS = 4;
+
+// splits a part of a pattern into fused loads, dropping anything that is only wildcards.
+// offsets are relative to the start of the part, the segment holding the anchor byte goes
+// first. returns the segment count, out may be null.
+constexpr auto split_pattern(const PatternData& p, u32 part, PatternSegment* out) -> u32 {
+    const u32 size = p.parts[part].size;
+    const auto value = p.value + p.parts[part].offset;
+    const auto mask = p.mask + p.parts[part].offset;
+
+    u32 count{};
+    for (u32 i = 0; i < size;) {
+        if (!mask[i]) {
+            i++;
+            continue;
+        }
+
+        u32 len{};
+        for (u32 j = i; j < i + 8 && j < size; j++) {
+            if (mask[j]) {
+                len = j - i + 1;
+            }
+        }
+
+        const u8 width = len <= 1 ? 1 : len <= 2 ? 2 : len <= 4 ? 4 : 8;
+        if (out) {
+            PatternSegment seg{ static_cast<u8>(i), width, 0, 0 };
+            for (u32 j = 0; j < width && i + j < size; j++) {
+                seg.value |= u64(value[i + j] & mask[i + j]) << (j * 8);
+                seg.mask |= u64(mask[i + j]) << (j * 8);
+            }
+
+            // rotate the anchor segment to the front
+            if (part == 0 && p.anchor_byte >= i && p.anchor_byte < i + width) {
+                for (u32 j = count; j > 0; j--) {
+                    out[j] = out[j - 1];
+                }
+                out[0] = seg;
+            } else {
+                out[count] = seg;
+            }
+        }
+        count++;
+        i += width;
+    }
+    return count;
+}
+
+// true if the first part only compares whole nibbles, which is all that the arena can hold.
+constexpr auto nibble_aligned(const PatternData& p) -> bool {
+    for (u32 i = 0; i < p.size; i++) {
+        for (u8 nibble : { 0x0F, 0xF0 }) {
+            if ((p.mask[i] & nibble) && (p.mask[i] & nibble) != nibble) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+using MatchFn = bool (*)(const u8* data);
+
+// matcher specialised for a single pattern of a layout, the pattern is a template
+// parameter, so every load, compare value and mask is a compile-time constant.
+// long patterns are compared against the title's arena instead.
+// same read requirements as pattern_matches(), up to the extent of the pattern.
+template<const auto& layout, const auto& arena, u32 Index>
+struct PatternMatcher {
+    static constexpr const PatternData& pattern = layout.compare[Index];
+
+    template<u32 Part>
+    static constexpr auto segments = [] {
+        std::array<PatternSegment, split_pattern(pattern, Part, nullptr)> s{};
+        split_pattern(pattern, Part, s.data());
+        return s;
+    }();
+
+    template<u32 Part, u32 N>
+    static auto segment_matches(const u8* data) -> bool {
+        constexpr auto seg = segments<Part>[N];
+        using T = std::conditional_t<seg.width == 1, u8, std::conditional_t<seg.width == 2, u16, std::conditional_t<seg.width == 4, u32, u64>>>;
+        constexpr auto full = static_cast<T>(~T{});
+
+        const auto v = load<T>(data + seg.offset);
+        if constexpr (static_cast<T>(seg.mask) == full) {
+            return v == static_cast<T>(seg.value);
+        } else {
+            return !((v ^ static_cast<T>(seg.value)) & static_cast<T>(seg.mask));
+        }
+    }
+
+    template<u32 Part, u32 C>
+    static auto class_matches(const u8* data) -> bool {
+        constexpr auto part = pattern.parts[Part];
+        constexpr auto c = pattern.classes[C];
+        if constexpr (c.offset < part.offset || c.offset >= part.offset + part.size) {
+            return true;
+        } else {
+            const auto b = data[c.offset - part.offset];
+            bool hit{};
+            for (u32 i = 0; i < c.count; i++) {
+                hit |= b == c.options[i];
+            }
+            return hit;
+        }
+    }
+
+    template<u32 Part>
+    static auto part_matches(const u8* data) -> bool {
+        if constexpr (Part == 0 && segments<0>.size() > MAX_UNROLLED_SEGMENTS && nibble_aligned(layout.patterns[Index])) {
+            if (!pattern_matches(data, arena.bytes, arena.refs[Index])) {
+                return false;
+            }
+        } else if (![data]<u32... N>(std::integer_sequence<u32, N...>) {
+            return (segment_matches<Part, N>(data) && ...);
+        }(std::make_integer_sequence<u32, segments<Part>.size()>{})) {
+            return false;
+        }
+
+        return [data]<u32... C>(std::integer_sequence<u32, C...>) {
+            return (class_matches<Part, C>(data) && ...);
+        }(std::make_integer_sequence<u32, pattern.num_classes>{});
+    }
+
+    // every part after the first is tried at each offset that its gap allows.
+    template<u32 Part>
+    static auto parts_match(const u8* data) -> bool {
+        if constexpr (Part == pattern.num_parts) {
+            return true;
+        } else {
+            constexpr auto part = pattern.parts[Part];
+            for (u32 gap = part.gap_min; gap <= part.gap_max; gap++) {
+                if (part_matches<Part>(data + gap) && parts_match<Part + 1>(data + gap + part.size)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    static auto match(const u8* data) -> bool {
+        return parts_match<0>(data);
+    }
 };
 
+// a patch as parsed from its string, only used at compile time to fill PATCH_POOL.
 struct PatchData {
     constexpr PatchData(const char* s) {
         str2hex(s, data, size);
@@ -69,14 +609,75 @@ struct PatchData {
         }
     }
 
-    constexpr auto cmp(const void* _data) -> bool {
-        return !std::memcmp(data, _data, size);
-    }
+    u8 data[MAX_PATTERN_SIZE]{};
+    u8 size{};
+};
+
+// location of a patch within PATCH_POOL.
+struct PatchRef {
+    constexpr auto data() const -> const u8*;
+    constexpr auto cmp(const void* _data) const -> bool;
 
-    u8 data[20]{}; // reasonable max patch length, adjust as needed
+    u16 offset{};
     u8 size{};
 };
 
+// one term of an InstCond.
+struct InstTerm {
+    u32 mask;
+    u32 value;
+};
+
+// condition on the instruction at inst_offset, it holds if (inst & mask) == value for any term.
+struct InstCond {
+    static constexpr u32 MAX_TERMS = 8;
+
+    // a condition on just the top byte of the instruction, which holds the opcode for most of them.
+    static consteval auto top_byte(std::initializer_list<u8> bytes) -> InstCond {
+        InstCond c{};
+        for (auto b : bytes) {
+            c.add({ 0xFF000000, u32(b) << 24 });
+        }
+        return c;
+    }
+
+    consteval InstCond() {
+        // unused terms can never hold
+        for (u32 i = 0; i < MAX_TERMS; i++) {
+            mask[i] = 0;
+            value[i] = 1;
+        }
+    }
+
+    consteval InstCond(std::initializer_list<InstTerm> terms) : InstCond() {
+        for (auto t : terms) {
+            add(t);
+        }
+    }
+
+    consteval void add(InstTerm t) {
+        if (count == MAX_TERMS) {
+            constexpr_fail("an InstCond has more than MAX_TERMS terms");
+        }
+        mask[count] = t.mask;
+        value[count] = t.value;
+        count++;
+    }
+
+    // every term is checked, so this compiles to a few vector compares with no branch per term.
+    constexpr auto matches(u32 inst) const -> bool {
+        u32 hit{};
+        for (u32 i = 0; i < MAX_TERMS; i++) {
+            hit |= (inst & mask[i]) == value[i];
+        }
+        return hit;
+    }
+
+    u32 mask[MAX_TERMS]{};
+    u32 value[MAX_TERMS]{};
+    u32 count{};
+};
+
 enum class PatchResult {
     NOT_FOUND,
     SKIPPED,
@@ -84,8 +685,11 @@ enum class PatchResult {
     PATCHED_FILE,
     PATCHED_SYSPATCH,
     FAILED_WRITE,
+    TIMED_OUT,
 };
 
+// a row of the pattern tables below, only used at compile time.
+// at runtime it is split into a HotPattern, PatternMeta and PatternState.
 struct Patterns {
     const char* patch_name; // name of patch
     const PatternData byte_pattern; // the pattern to search
@@ -93,454 +697,2075 @@ struct Patterns {
     const s32 inst_offset; // instruction offset relative to byte pattern
     const s32 patch_offset; // patch offset relative to inst_offset
 
-    bool (*const cond)(u32 inst); // check condition of the instruction
-    PatchData (*const patch)(u32 inst); // the patch data to be applied
-    bool (*const applied)(const u8* data, u32 inst); // check to see if patch already applied
+    const InstCond& cond; // check condition of the instruction
+    const PatchRef patch; // the patch data to be applied, also used to see if the patch is already applied
 
-    bool enabled; // controlled by config.ini
-    const u32 match_index; // zero-based pattern match to use
+    const bool enabled; // default, overridden by config.ini
+    const u32 match_index; // zero-based pattern match to use, matches that don't put inst_offset on a 4 byte boundary aren't counted
 
     const u32 min_fw_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
     const u32 max_fw_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
     const u32 min_ams_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
     const u32 max_ams_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
+};
+
+// the parts of a pattern that are only needed once it matched, or once per title.
+struct PatternMeta {
+    const char* patch_name{};
+    s32 patch_offset{};
+
+    const InstCond* cond{};
+    PatchRef patch{};
+
+    bool enabled{};
+    u32 match_index{};
+
+    u32 min_fw_ver{};
+    u32 max_fw_ver{};
+    u32 min_ams_ver{};
+    u32 max_ams_ver{};
+};
 
+template<const auto& patterns>
+consteval auto make_pattern_meta() {
+    std::array<PatternMeta, std::size(patterns)> meta{};
+    for (u32 i = 0; i < meta.size(); i++) {
+        const auto& p = patterns[i];
+        meta[i] = {
+            p.patch_name, p.patch_offset, &p.cond, p.patch, p.enabled, p.match_index,
+            p.min_fw_ver, p.max_fw_ver, p.min_ams_ver, p.max_ams_ver,
+        };
+    }
+    return meta;
+}
+
+// runtime state of a pattern, the only part of a pattern that is written to.
+struct PatternState {
     PatchResult result{PatchResult::NOT_FOUND};
     u64 logged_offset{};
     u32 match_count{};
-    u64 last_match_addr{};
-    bool has_last_match{};
 };
 
-struct PatchEntry {
-    const char* name; // name of the system title
-    const u64 title_id; // title id of the system title
-    const std::span<Patterns> patterns; // list of patterns to find
-    const u32 min_fw_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
-    const u32 max_fw_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
+// range of bytes around the start of a match that a pattern reads, this covers
+// the pattern itself, the instruction and the patch, which may sit on either side.
+struct PatternWindow {
+    s16 begin; // <= 0
+    s16 end; // >= pattern extent
 };
 
-// naming convention should if possible adhere to either an arm instruction + _cond,
-// example: "bl_cond"
-// or naming it specific to what is being patched, and including all possible bytes within the address being tested for the given patch.
-// example: "ctest_cond"
+constexpr auto to_s16(s32 v) -> s16 {
+    if (v < -0x8000 || v > 0x7FFF) {
+        constexpr_fail("a pattern reads further from its start than an s16 holds");
+    }
+    return static_cast<s16>(v);
+}
+
+constexpr auto pattern_window(const Patterns& p) -> PatternWindow {
+    const s32 patch_begin = p.inst_offset + p.patch_offset;
+    const s32 patch_end = patch_begin + p.patch.size;
+    return {
+        to_s16(std::min({ 0, p.inst_offset, patch_begin })),
+        to_s16(std::max({ static_cast<s32>(p.byte_pattern.extent()), p.inst_offset + 4, patch_end })),
+    };
+}
+
+// each row of a table, and each unique pattern, is tracked as a single bit during a scan.
+constexpr u32 MAX_PATTERNS_PER_TITLE = 32;
+
+// pattern that doesn't extend another one.
+constexpr u8 NO_BASE = 0xFF;
+
+constexpr auto literal_bits(const PatternData& p) -> u32 {
+    u32 count{};
+    for (u32 i = 0; i < p.total(); i++) {
+        count += std::popcount(p.mask[i]);
+    }
+    return count;
+}
+
+constexpr auto identical(const PatternData& a, const PatternData& b) -> bool {
+    if (a.num_parts != b.num_parts || a.num_classes != b.num_classes) {
+        return false;
+    }
+    for (u32 i = 0; i < a.num_parts; i++) {
+        const auto& x = a.parts[i];
+        const auto& y = b.parts[i];
+        if (x.offset != y.offset || x.size != y.size || x.gap_min != y.gap_min || x.gap_max != y.gap_max) {
+            return false;
+        }
+    }
+    for (u32 i = 0; i < a.total(); i++) {
+        if (a.value[i] != b.value[i] || a.mask[i] != b.mask[i]) {
+            return false;
+        }
+    }
+    for (u32 i = 0; i < a.num_classes; i++) {
+        const auto& x = a.classes[i];
+        const auto& y = b.classes[i];
+        if (x.offset != y.offset || x.count != y.count || !std::equal(x.options, x.options + x.count, y.options)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-constexpr auto sub_cond(u32 inst) -> bool {
-    const auto type = inst >> 24;
-    return type == 0xD1; // sub sp, sp, #0x150
+// true if every bit that a compares is also compared, to the same value, by b, so that b can
+// only match where a does. trailing wildcards don't change what a pattern matches, the row
+// windows still cover them. a pattern with gaps or byte classes only covers identical ones.
+constexpr auto covers(const PatternData& a, const PatternData& b) -> bool {
+    if (a.num_parts > 1 || a.num_classes) {
+        return identical(a, b);
+    }
+    for (u32 i = 0; i < a.size; i++) {
+        const u8 m = i < b.size ? b.mask[i] : 0;
+        if ((a.mask[i] & ~m) || ((a.value[i] ^ b.value[i]) & a.mask[i])) {
+            return false;
+        }
+    }
+    return true;
 }
 
-constexpr auto cmp_cond(u32 inst) -> bool {
-    const auto type = inst >> 24;
-    return type == 0x6B || // cmp w0, w1
-           type == 0xF1;   // cmp x0, #0x1
+constexpr auto same_pattern(const PatternData& a, const PatternData& b) -> bool {
+    return covers(a, b) && covers(b, a);
 }
 
-constexpr auto bl_cond(u32 inst) -> bool {
-    const auto type = inst >> 24;
-    return type == 0x25 ||
-           type == 0x94 ||
-           type == 0x97;
+constexpr auto unique_pattern_count(std::span<const Patterns> patterns) -> u32 {
+    u32 count{};
+    for (u32 i = 0; i < patterns.size(); i++) {
+        bool seen{};
+        for (u32 j = 0; j < i && !seen; j++) {
+            seen = same_pattern(patterns[j].byte_pattern, patterns[i].byte_pattern);
+        }
+        count += !seen;
+    }
+    return count;
 }
 
-constexpr auto tbz_cond(u32 inst) -> bool {
-    return ((inst >> 24) & 0x7F) == 0x36;
+// the unique byte patterns of a table, each is searched for once no matter how many rows use it.
+// a pattern that only adds bytes to another one extends it, it is only compared once its
+// base matched and then only for the bytes that the base didn't already compare.
+template<u32 Rows, u32 Count>
+struct PatternLayout {
+    PatternData patterns[Count]{}; // full pattern
+    PatternData compare[Count]{}; // bytes left to compare once the base matched
+    u8 base[Count]{}; // NO_BASE, or the pattern this one extends
+    u8 pattern[Rows]{}; // pattern used by each row
+};
+
+template<const auto& patterns>
+consteval auto make_pattern_layout() {
+    constexpr u32 rows = std::size(patterns);
+    constexpr u32 count = unique_pattern_count(patterns);
+    static_assert(rows <= MAX_PATTERNS_PER_TITLE, "too many patterns for a single title");
+    PatternLayout<rows, count> l{};
+
+    u32 n{};
+    for (u32 i = 0; i < rows; i++) {
+        const auto& p = patterns[i].byte_pattern;
+        u32 u{};
+        while (u < n && !same_pattern(l.patterns[u], p)) {
+            u++;
+        }
+        if (u == n) {
+            l.patterns[n++] = p;
+        }
+        l.pattern[i] = u;
+    }
+
+    // the base is the covering pattern with the fewest literal bits, nothing can cover
+    // that one in turn, so extensions are only ever one level deep.
+    for (u32 u = 0; u < count; u++) {
+        l.base[u] = NO_BASE;
+        for (u32 b = 0; b < count; b++) {
+            if (b != u && covers(l.patterns[b], l.patterns[u]) &&
+                (l.base[u] == NO_BASE || literal_bits(l.patterns[b]) < literal_bits(l.patterns[l.base[u]]))) {
+                l.base[u] = b;
+            }
+        }
+
+        l.compare[u] = l.patterns[u];
+        if (l.base[u] != NO_BASE) {
+            const auto& base = l.patterns[l.base[u]];
+            for (u32 i = 0; i < base.size; i++) {
+                l.compare[u].mask[i] &= ~base.mask[i];
+            }
+            l.compare[u].find_anchor(); // only orders the compares, so it's fine if nothing is left
+        }
+    }
+    return l;
 }
 
-constexpr auto adr_cond(u32 inst) -> bool {
-    return (inst >> 24) == 0x10; // adr x2, LAB
+template<u32 Count, u32 Size>
+struct PatternArena {
+    PatternRef refs[Count]{};
+    u8 bytes[Size]{}; // packed patterns, see PatternRef
+};
+
+// the vector compares read up to VECTOR_SIZE bytes past the end of the last pattern.
+constexpr auto arena_size(std::span<const PatternData> patterns) -> u32 {
+    u32 size = VECTOR_SIZE;
+    for (const auto& p : patterns) {
+        size += packed_size(p.size);
+    }
+    return size;
 }
 
-constexpr auto block_fw_updates_cond(u32 inst) -> bool {
-    const auto type = inst >> 24;
-    return type == 0xA8 ||
-           type == 0xA9 ||
-           type == 0xF8 ||
-           type == 0xF9;
+template<const auto& layout>
+consteval auto make_pattern_arena() {
+    constexpr u32 count = std::size(layout.patterns);
+    constexpr u32 size = arena_size(layout.patterns);
+    static_assert(size <= 0x10000, "arena offsets must fit in a u16");
+    PatternArena<count, size> a{};
+
+    u32 offset{};
+    for (u32 i = 0; i < count; i++) {
+        const auto& pd = layout.patterns[i];
+        for (u32 j = 0; j < pd.size; j++) {
+            a.bytes[offset + j] = pd.value[j];
+            for (u32 n = 0; n < 2; n++) {
+                if (((pd.mask[j] >> (n * 4)) & 0xF) == 0xF) {
+                    a.bytes[offset + pd.size + j / 4] |= 1 << (j % 4 * 2 + n);
+                }
+            }
+        }
+
+        a.refs[i] = { static_cast<u16>(offset), pd.size, pd.anchor_byte, pd.value[pd.anchor_byte] };
+        offset += packed_size(pd.size);
+    }
+    return a;
 }
 
-constexpr auto es_cond(u32 inst) -> bool {
-    const auto type = inst >> 24;
-    return type == 0xD1 ||
-           type == 0xA9 ||
-           type == 0xAA ||
-           type == 0x2A ||
-           type == 0x92;
-}
+// trie used at compile time to lay out the automaton states.
+template<u32 MaxNodes>
+struct LiteralTrie {
+    struct Node {
+        u16 child{}; // first child, 0 if none (root can never be a child)
+        u16 sibling{}; // next sibling, 0 if none
+        u8 byte{};
+    };
+
+    constexpr auto find(u16 node, u8 byte) const -> u16 {
+        for (auto c = nodes[node].child; c; c = nodes[c].sibling) {
+            if (nodes[c].byte == byte) {
+                return c;
+            }
+        }
+        return 0;
+    }
+
+    // returns the node that the run ends on.
+    constexpr auto insert(const PatternData& p, LiteralRun run) -> u16 {
+        u16 node = 0;
+        for (u8 i = run.offset; i < run.offset + run.size; i++) {
+            const auto byte = p.value[i];
+            auto next = find(node, byte);
+            if (!next) {
+                next = count++;
+                nodes[next] = { 0, nodes[node].child, byte };
+                nodes[node].child = next;
+            }
+            node = next;
+        }
+        return node;
+    }
+
+    Node nodes[MaxNodes]{};
+    u16 count{1};
+};
+
+struct AutomatonSize {
+    u32 states;
+    u32 classes;
+};
+
+// only patterns that don't extend another one are part of the automaton.
+constexpr auto automaton_size(std::span<const PatternData> patterns, std::span<const u8> base) -> AutomatonSize {
+    bool seen[256]{};
+    u32 classes = 1; // class 0 is every byte that doesn't appear in an anchor
+    LiteralTrie<1 + MAX_PATTERN_SIZE * MAX_PATTERNS_PER_TITLE> trie{};
+
+    for (u32 u = 0; u < patterns.size(); u++) {
+        if (base[u] != NO_BASE) {
+            continue;
+        }
+        const auto& p = patterns[u];
+        for (u8 i = p.anchor.offset; i < p.anchor.offset + p.anchor.size; i++) {
+            if (!seen[p.value[i]]) {
+                seen[p.value[i]] = true;
+                classes++;
+            }
+        }
+        trie.insert(p, p.anchor);
+    }
+
+    return { trie.count, classes };
+}
+
+// non-template view of an Automaton, used by the scanner.
+struct AutomatonView {
+    const u8* byte_class;
+    const u8* next;
+    const u32* out;
+    u32 num_classes;
+    u32 lookahead;
+    u32 history;
+};
+
+// aho-corasick automaton over the anchor of every base pattern of a title.
+// transitions are fully resolved (dfa), so scanning is a single table lookup per byte.
+// a hit only means the anchor was found, the full pattern still needs to be compared.
+template<u32 States, u32 Classes, u32 Count>
+struct Automaton {
+    static_assert(States <= 0x100, "automaton states must fit in a u8");
+
+    constexpr auto view() const -> AutomatonView {
+        return { byte_class, &next[0][0], out, Classes, lookahead, history };
+    }
+
+    u8 byte_class[256]{}; // maps a byte to its input class
+    u8 next[States][Classes]{}; // next state for (state, class)
+    u32 out[States]{}; // patterns whose anchor ends in this state
+    u8 run_end[Count]{}; // offset from the start of the pattern to the end of its (or its base's) anchor
+    u32 lookahead{}; // bytes needed past the end of an anchor to check any row
+    u32 history{}; // bytes that have to be kept from one chunk to the next
+};
+
+template<const auto& patterns, const auto& layout>
+consteval auto make_automaton() {
+    constexpr auto size = automaton_size(layout.patterns, layout.base);
+    constexpr u32 count = std::size(layout.patterns);
+    constexpr u32 rows = std::size(patterns);
+    Automaton<size.states, size.classes, count> a{};
+    LiteralTrie<size.states> trie{};
+
+    u32 classes = 1;
+    for (u32 u = 0; u < count; u++) {
+        if (layout.base[u] != NO_BASE) {
+            continue;
+        }
+        const auto& p = layout.patterns[u];
+        const auto run = p.anchor;
+        for (u8 j = run.offset; j < run.offset + run.size; j++) {
+            if (!a.byte_class[p.value[j]]) {
+                a.byte_class[p.value[j]] = classes++;
+            }
+        }
+        a.out[trie.insert(p, run)] |= 1U << u;
+        a.run_end[u] = run.offset + run.size;
+    }
+
+    // extensions start wherever their base does
+    for (u32 u = 0; u < count; u++) {
+        if (layout.base[u] != NO_BASE) {
+            a.run_end[u] = a.run_end[layout.base[u]];
+        }
+    }
+
+    // base pattern of every row, and the combined window of the rows of each base.
+    u8 root[rows]{};
+    PatternWindow window[rows]{};
+    PatternWindow family[count]{};
+    for (u32 i = 0; i < rows; i++) {
+        const auto u = layout.pattern[i];
+        root[i] = layout.base[u] == NO_BASE ? u : layout.base[u];
+        window[i] = pattern_window(patterns[i]);
+        a.lookahead = std::max<u32>(a.lookahead, window[i].end - a.run_end[u]);
+        family[root[i]].begin = std::min(family[root[i]].begin, window[i].begin);
+        family[root[i]].end = std::max(family[root[i]].end, window[i].end);
+    }
+
+    // the automaton stops lookahead bytes short of the end of a chunk, so a hit on
+    // the next chunk can still need up to run_end - window.begin bytes before that.
+    // when searching for a single base pattern, only the windows of its rows have to be kept.
+    // the anchor and reference engines test every base over the same starts, so they
+    // need the windows of all rows at once.
+    PatternWindow all{};
+    for (u32 i = 0; i < rows; i++) {
+        a.history = std::max<u32>(a.history, a.lookahead + a.run_end[root[i]] - window[i].begin);
+        a.history = std::max<u32>(a.history, family[root[i]].end - family[root[i]].begin);
+        all.begin = std::min(all.begin, window[i].begin);
+        all.end = std::max(all.end, window[i].end);
+    }
+    a.history = std::max<u32>(a.history, all.end - all.begin);
+
+    // resolve failure links breadth first, so the failure state of a node
+    // is always complete by the time the node itself is visited.
+    u16 queue[size.states]{};
+    u16 fail[size.states]{};
+    u32 head{}, tail{};
+
+    for (u32 c = 0; c < size.classes; c++) {
+        a.next[0][c] = 0;
+    }
+    for (auto child = trie.nodes[0].child; child; child = trie.nodes[child].sibling) {
+        a.next[0][a.byte_class[trie.nodes[child].byte]] = child;
+        queue[tail++] = child;
+    }
+
+    while (head < tail) {
+        const auto node = queue[head++];
+        a.out[node] |= a.out[fail[node]];
+
+        for (u32 c = 0; c < size.classes; c++) {
+            a.next[node][c] = a.next[fail[node]][c];
+        }
+        for (auto child = trie.nodes[node].child; child; child = trie.nodes[child].sibling) {
+            const auto c = a.byte_class[trie.nodes[child].byte];
+            fail[child] = a.next[fail[node]][c];
+            a.next[node][c] = child;
+            queue[tail++] = child;
+        }
+    }
+
+    return a;
+}
+
+// a unique pattern of a title, as read by the scan loop.
+struct HotPattern {
+    MatchFn match; // compares the pattern at a given start, for an extension only the bytes its base doesn't
+    u32 rows; // rows of the table that use this pattern
+    u32 extensions; // patterns that extend this one
+    PatternRef pattern;
+    u8 run_end; // offset from the start of the pattern to the end of its (or its base's) anchor
+    u8 base; // NO_BASE, or the pattern this one extends
+};
+
+// a row of a table, as read by the scan loop.
+struct HotRow {
+    s16 inst_offset; // instruction offset relative to byte pattern
+    PatternWindow window; // bytes read by the row, relative to the start of the pattern
+};
+
+static_assert(sizeof(HotPattern) <= 24);
+static_assert(sizeof(HotRow) <= 6);
+
+template<u32 Count, u32 Rows>
+struct HotTable {
+    HotPattern patterns[Count]{};
+    HotRow rows[Rows]{};
+};
+
+constexpr u32 CACHE_LINE_SIZE = 64;
+constexpr u32 MAX_HOT_CACHE_LINES = 4; // per title
+
+// everything the scan loop reads, contiguous and read-only.
+// names, conditions and patches are kept in PatternMeta.
+template<const auto& patterns, const auto& layout, const auto& arena, const auto& automaton>
+consteval auto make_hot_table() {
+    constexpr u32 count = std::size(layout.patterns);
+    constexpr u32 rows = std::size(patterns);
+    static_assert(sizeof(HotTable<count, rows>) <= MAX_HOT_CACHE_LINES * CACHE_LINE_SIZE, "hot table of a title no longer fits in a few cache lines");
+
+    auto t = []<u32... I>(std::integer_sequence<u32, I...>) {
+        return HotTable<count, rows>{ { HotPattern{
+            &PatternMatcher<layout, arena, I>::match, 0, 0, arena.refs[I], automaton.run_end[I], layout.base[I],
+        }... } };
+    }(std::make_integer_sequence<u32, count>{});
+
+    for (u32 i = 0; i < rows; i++) {
+        const auto u = layout.pattern[i];
+        t.patterns[u].rows |= 1U << i;
+        t.rows[i] = { to_s16(patterns[i].inst_offset), pattern_window(patterns[i]) };
+    }
+    for (u32 u = 0; u < count; u++) {
+        if (layout.base[u] != NO_BASE) {
+            t.patterns[layout.base[u]].extensions |= 1U << u;
+        }
+    }
+    return t;
+}
+
+// every table the scanner uses for a title, made from its patterns. only the state of each
+// row is written to, by the scan.
+template<const auto& patterns>
+struct TitleTables {
+    static constexpr auto layout = make_pattern_layout<patterns>();
+    static constexpr auto arena = make_pattern_arena<layout>();
+    static constexpr auto automaton = make_automaton<patterns, layout>();
+    static constexpr auto hot = make_hot_table<patterns, layout, arena, automaton>();
+    static constexpr auto meta = make_pattern_meta<patterns>();
+    static inline PatternState state[std::size(patterns)]{};
+};
+
+// most bytes the title of any of patterns needs kept from one chunk to the next.
+template<const auto&... patterns>
+consteval auto max_history() -> u32 {
+    return std::max({ TitleTables<patterns>::automaton.history... });
+}
+
+// order in which titles are patched, and how urgently.
+enum class TitleClass : u8 {
+    Critical, // gates booting correctly, patched first at a raised priority
+    Normal,
+    Deferrable, // only needed once the system is up, patched last at a lowered priority
+};
+
+// thread priority of each class relative to the worker priority, lower runs first.
+constexpr s32 TITLE_CLASS_PRIORITY[] = { -5, 0, 10 };
+
+struct PatchEntry {
+    const char* name; // name of the system title
+    const u64 title_id; // title id of the system title
+    const std::span<const HotPattern> hot; // unique patterns, read for every candidate position
+    const std::span<const HotRow> rows; // read for every candidate position
+    const std::span<const PatternMeta> meta; // read once per title and on a match
+    const std::span<PatternState> state; // result of each row
+    const AutomatonView automaton; // matches every pattern in a single pass
+    const TitleClass title_class;
+    const u32 min_fw_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
+    const u32 max_fw_ver{FW_VER_ANY}; // set to FW_VER_ANY to ignore
+    u32 active{}; // rows to search for, set on startup by set_active_rows()
+    u64 pid{}; // set by find_processes(), 0 if the title isn't running
+    u8 engine{}; // ENGINE_AUTO or engine number, set by config.ini, then to the engine that was used
+    u8 mismatched{}; // engines that disagreed with the reference engine, one bit per engine number
+    u64 done_tick{}; // when the title was done, 0 if it wasn't scanned
+    u64 debug_ticks{}; // how long the title was held under a debug session
+    u64 timed_out_ticks{}; // how long the title was worked on before it timed out
+};
+
+// naming convention should if possible adhere to either an arm instruction + _cond,
+// example: "bl_cond"
+// or naming it specific to what is being patched, and including all possible bytes within the address being tested for the given patch.
+// example: "ctest_cond"
+
+constexpr InstCond sub_cond = InstCond::top_byte({
+    0xD1, // sub sp, sp, #0x150
+});
+
+constexpr InstCond cmp_cond = InstCond::top_byte({
+    0x6B, // cmp w0, w1
+    0xF1, // cmp x0, #0x1
+});
+
+constexpr InstCond bl_cond = InstCond::top_byte({ 0x25, 0x94, 0x97 });
+
+constexpr InstCond tbz_cond{ { 0x7F000000, 0x36000000 } };
+
+constexpr InstCond adr_cond = InstCond::top_byte({
+    0x10, // adr x2, LAB
+});
+
+constexpr InstCond block_fw_updates_cond = InstCond::top_byte({ 0xA8, 0xA9, 0xF8, 0xF9 });
+
+constexpr InstCond es_cond = InstCond::top_byte({ 0xD1, 0xA9, 0xAA, 0x2A, 0x92 });
+
+constexpr InstCond ctest_cond = InstCond::top_byte({ 0xF9, 0xA9, 0xF8 });
+
+constexpr InstCond strb_cond = InstCond::top_byte({
+    0x39, // 68 02 00 39, strb w8, [x19]
+});
+
+// to view patches, use https://armconverter.com/?lock=arm64
+constexpr PatchData ret0_patch_data{ "0xE0031F2A" };
+constexpr PatchData ret1_patch_data{ "0x200080D2" };
+constexpr PatchData mov0_ret_patch_data{ "0xE0031F2AC0035FD6" };
+constexpr PatchData nop_patch_data{ "0x1F2003D5" };
+//mov x0, xzr
+constexpr PatchData mov0_patch_data{ "0xE0031FAA" };
+//mov x2, xzr
+constexpr PatchData mov2_patch_data{ "0xE2031FAA" };
+constexpr PatchData cmp_patch_data{ "0x00" };
+constexpr PatchData ctest_patch_data{ "0x00309AD2001EA1F2610100D4E0031FAAC0035FD6" };
+constexpr PatchData strb0_patch_data{ "0x7F020039"};
+//strb wzr, [x19]
+
+// NOTE: every patch above has to be listed here to end up in PATCH_POOL.
+constexpr const PatchData* patch_list[] = {
+    &ret0_patch_data, &ret1_patch_data, &mov0_ret_patch_data, &nop_patch_data, &mov0_patch_data,
+    &mov2_patch_data, &cmp_patch_data, &ctest_patch_data, &strb0_patch_data,
+};
+
+constexpr auto patch_pool_size() -> u32 {
+    u32 size{};
+    for (const auto* p : patch_list) {
+        size += p->size;
+    }
+    return size;
+}
+
+// the bytes of every patch, packed back to back.
+constexpr auto PATCH_POOL = [] {
+    std::array<u8, patch_pool_size()> pool{};
+    u32 offset{};
+    for (const auto* p : patch_list) {
+        for (u32 i = 0; i < p->size; i++) {
+            pool[offset++] = p->data[i];
+        }
+    }
+    return pool;
+}();
+
+static_assert(PATCH_POOL.size() <= 0x10000, "patch offsets must fit in a u16");
+
+consteval auto patch_ref(const PatchData& patch) -> PatchRef {
+    u32 offset{};
+    for (const auto* p : patch_list) {
+        if (p == &patch) {
+            return { static_cast<u16>(offset), patch.size };
+        }
+        offset += p->size;
+    }
+    constexpr_fail("every patch has to be listed in patch_list");
+    return {};
+}
+
+constexpr auto PatchRef::data() const -> const u8* {
+    return PATCH_POOL.data() + offset;
+}
+
+constexpr auto PatchRef::cmp(const void* _data) const -> bool {
+    return !std::memcmp(data(), _data, size);
+}
+
+constexpr PatchRef ret0_patch = patch_ref(ret0_patch_data);
+constexpr PatchRef ret1_patch = patch_ref(ret1_patch_data);
+constexpr PatchRef mov0_ret_patch = patch_ref(mov0_ret_patch_data);
+constexpr PatchRef nop_patch = patch_ref(nop_patch_data);
+constexpr PatchRef mov0_patch = patch_ref(mov0_patch_data);
+constexpr PatchRef mov2_patch = patch_ref(mov2_patch_data);
+constexpr PatchRef cmp_patch = patch_ref(cmp_patch_data);
+constexpr PatchRef ctest_patch = patch_ref(ctest_patch_data);
+constexpr PatchRef strb0_patch = patch_ref(strb0_patch_data);
+
+// patterns should be optimized in such a manner that they yield only one result, unless match_index selects a specific result.
+// patterns might yield results for more firmware versions, but if it yields more than one result (per firmware version), it should be condensed to near similar versions instead which only yields one result.
+// a pattern should not contain the bytes being patched, they should be wildcarded.
+// if the bytes being patched align with the patch partially, then the partial bytes can be in the pattern, the same applies to if the pattern contains the length of the patch.
+// the bytes being tested are defined by the _cond, and does not need to be in the pattern, and shouldn't be in the pattern, if the bytes being tested are also the bytes being patched.
+// () indicate testing, {} indicate what is being patched
+// example:
+// "0x00....0240F9........E8", 6, 0,
+// the bytes being tested, and patch size is the same, 6 from start of pattern, then patch 0 from start of where the test was designated:
+// "0x00....0240F9{(........)}E8"
+// if moving the head from what is being tested, the bytes, if in pattern, should be wildcarded by the length of the patch being applied
+// "0x00....0240F9........E8C8FE4739", 6, 4,
+// example {} should be wildcarded, as those are the bytes being patched, the bytes being tested can in that context contain bytes in the pattern:
+// "0x00....0240F9(......94){E8C8FE47}39", 6, 4,
+// example with wildcarding:
+// "0x00....0240F9(......94){........}39", 6, 4,
+//
+// designing new patterns should ideally conform to specification above.
+
+constexpr Patterns fs_patterns[] = {
+    { "noacidsigchk_1.0.0-9.2.0", "0xC8FE4739", -24, 0, bl_cond, ret0_patch, true, 0, FW_VER_ANY, MAKEHOSVERSION(9,2,0) }, // moved to loader 10.0.0
+    { "noacidsigchk_1.0.0-9.2.0", "0x0210911F000072", -5, 0, bl_cond, ret0_patch, true, 0, FW_VER_ANY, MAKEHOSVERSION(9,2,0) }, // moved to loader 10.0.0
+    { "noncasigchk_1.0.0-3.0.2", "0x88..42..58", -4, 0, tbz_cond, nop_patch, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(3,0,2) },
+    { "noncasigchk_4.0.0-16.1.0", "0x1E4839....00......0054", -17, 0, tbz_cond, nop_patch, true, 0, MAKEHOSVERSION(4,0,0), MAKEHOSVERSION(16,1,0) },
+    { "noncasigchk_17.0.0+", "0x0694....00..42..0091", -18, 0, tbz_cond, nop_patch, true, 0, MAKEHOSVERSION(17,0,0), FW_VER_ANY },
+    { "nocntchk_1.0.0-18.1.0", "0x40F9........081C00121F05", 2, 0, bl_cond, ret0_patch, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(18,1,0) },
+    { "nocntchk_19.0.0+", "0x40F9............40B9091C", 2, 0, bl_cond, ret0_patch, true, 0, MAKEHOSVERSION(19,0,0), FW_VER_ANY },
+};
+
+constexpr Patterns ldr_patterns[] = {
+    { "noacidsigchk_10.0.0+", "0x009401C0BE121F00", 6, 2, cmp_cond, cmp_patch, true, 0, FW_VER_ANY }, // 1F00016B - cmp w0, w1 patched to 1F00006B - cmp w0, w0
+};
+
+constexpr Patterns erpt_patterns[] = {
+    { "no_erpt", "0xFD7B02A9FD830091F55B04A9", -4, 0, sub_cond, mov0_ret_patch, true, 0, FW_VER_ANY }, // FF4305D1 - sub sp, sp, #0x150 patched to E0031F2AC0035FD6 - mov w0, wzr, ret 
+};
+
+constexpr Patterns es_patterns[] = {
+    { "es_1.0.0-8.1.1", "0x0091....0094..7E4092", 10, 0, es_cond, mov0_patch, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(8,1,1) },
+    { "es_9.0.0-11.0.1", "0x00..........A0....D1....FF97", 14, 0, es_cond, mov0_patch, true, 0, MAKEHOSVERSION(9,0,0), MAKEHOSVERSION(11,0,1) },
+    { "es_12.0.0-18.1.0", "0x02........D2..52....0091", 32, 0, es_cond, mov0_patch, true, 0, MAKEHOSVERSION(12,0,0), MAKEHOSVERSION(18,1,0) },
+    { "es_19.0.0-21.2.0", "0xA1........031F2A....0091", 32, 0, es_cond, mov0_patch, true, 0, MAKEHOSVERSION(19,0,0), MAKEHOSVERSION(21,2,0) },
+    { "es_22.0.0+", "0xA0630091....FE97A08300D1....FE97", 16, 0, es_cond, mov0_patch, true, 0, MAKEHOSVERSION(22,0,0), FW_VER_ANY },
+};
+
+constexpr Patterns am_patterns[] = {
+    { "am_homebrew_fix_22.0.0+", "0x682646391F0500716100005460420691794DFF97", 16, 0, bl_cond, nop_patch, true, 0, MAKEHOSVERSION(22,0,0), FW_VER_ANY },
+};
+
+constexpr Patterns olsc_patterns[] = {
+    { "olsc_6.0.0-14.1.2", "0x00..73....F9....4039", 42, 0, bl_cond, ret1_patch, true, 0, MAKEHOSVERSION(6,0,0), MAKEHOSVERSION(14,1,2) },
+    { "olsc_15.0.0-18.1.0", "0x00..73....F9....4039", 38, 0, bl_cond, ret1_patch, true, 0, MAKEHOSVERSION(15,0,0), MAKEHOSVERSION(18,1,0) },
+    { "olsc_19.0.0+", "0x00..73....F9....4039", 42, 0, bl_cond, ret1_patch, true, 0, MAKEHOSVERSION(19,0,0), FW_VER_ANY },
+};
+
+constexpr Patterns nifm_patterns[] = {
+    { "ctest_1.0.0-19.0.1", "0x03..AAE003..AA......39....04F8........E0", -29, 0, ctest_cond, ctest_patch, true, 0, FW_VER_ANY, MAKEHOSVERSION(19,0,1) },
+    { "ctest_20.0.0+", "0x03..AA......AA..................0314AA....14AA", -17, 0, ctest_cond, ctest_patch, true, 0, MAKEHOSVERSION(20,0,0), FW_VER_ANY },
+};
+
+constexpr Patterns nim_patterns[] = {
+    { "blankcal0crashfix_17.0.0+", "0x00351F2003D5..............................97....0094....00..........61", 6, 0, adr_cond, mov2_patch, true, 0, MAKEHOSVERSION(17,0,0), FW_VER_ANY },
+    { "blockfirmwareupdates_1.0.0-5.1.0", "0x1139F3", -30, 0, block_fw_updates_cond, mov0_ret_patch, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(5,1,0) },
+    { "blockfirmwareupdates_6.0.0-6.2.0", "0xF30301AA..4E", -40, 0, block_fw_updates_cond, mov0_ret_patch, true, 0, MAKEHOSVERSION(6,0,0), MAKEHOSVERSION(6,2,0) },
+    { "blockfirmwareupdates_7.0.0-10.2.0", "0xF30301AA014C", -36, 0, block_fw_updates_cond, mov0_ret_patch, true, 0, MAKEHOSVERSION(7,0,0), MAKEHOSVERSION(10,2,0) },
+    { "blockfirmwareupdates_11.0.0-11.0.1", "0x9AF0....................C0035FD6", 16, 0, block_fw_updates_cond, mov0_ret_patch, true, 0, MAKEHOSVERSION(11,0,0), MAKEHOSVERSION(11,0,1) },
+    { "blockfirmwareupdates_12.0.0+", "0x41....4C............C0035FD6", 14, 0, block_fw_updates_cond, mov0_ret_patch, true, 0, MAKEHOSVERSION(12,0,0), FW_VER_ANY },
+};
+
+constexpr Patterns ns_patterns[] = {
+    { "force_gamecard_region_to_global", "0x35E8134039F4031F..68020039", 9, 0, strb_cond, strb0_patch, true, 1, MAKEHOSVERSION(9,0,0), FW_VER_ANY },
+};
+
+// bytes kept between chunks, enough for any title. a title in patches[] that needs more
+// than the titles listed here fails the build, see make_patch_entry().
+constexpr u32 STREAM_HISTORY = max_history<
+    fs_patterns, ldr_patterns, erpt_patterns, es_patterns, olsc_patterns,
+    nifm_patterns, nim_patterns, am_patterns, ns_patterns>();
+
+// the entry of a title in patches[], made from the tables of its patterns.
+template<const auto& patterns>
+constexpr auto make_patch_entry(const char* name, u64 title_id, TitleClass title_class, u32 min_fw_ver = FW_VER_ANY, u32 max_fw_ver = FW_VER_ANY) -> PatchEntry {
+    using T = TitleTables<patterns>;
+    static_assert(T::automaton.history <= STREAM_HISTORY, "STREAM_HISTORY is too small for the title, list its patterns there");
+    return { name, title_id, T::hot.patterns, T::hot.rows, T::meta, T::state, T::automaton.view(), title_class, min_fw_ver, max_fw_ver };
+}
+
+// NOTE: add system titles that you want to be patched to this table.
+// a list of system titles can be found here https://switchbrew.org/wiki/Title_list
+constinit PatchEntry patches[] = {
+    make_patch_entry<fs_patterns>("fs", 0x0100000000000000, TitleClass::Critical),
+    // ldr needs to be patched in fw 10+
+    make_patch_entry<ldr_patterns>("ldr", 0x0100000000000001, TitleClass::Critical, MAKEHOSVERSION(10,0,0)),
+    // erpt no write patch
+    make_patch_entry<erpt_patterns>("erpt", 0x010000000000002B, TitleClass::Deferrable, MAKEHOSVERSION(10,0,0)),
+    // es was added in fw 2
+    make_patch_entry<es_patterns>("es", 0x0100000000000033, TitleClass::Critical, MAKEHOSVERSION(2,0,0)),
+    // olsc was added in fw 6
+    make_patch_entry<olsc_patterns>("olsc", 0x010000000000003E, TitleClass::Deferrable, MAKEHOSVERSION(6,0,0)),
+    make_patch_entry<nifm_patterns>("nifm", 0x010000000000000F, TitleClass::Normal),
+    make_patch_entry<nim_patterns>("nim", 0x0100000000000025, TitleClass::Deferrable),
+    make_patch_entry<am_patterns>("am", 0x0100000000000023, TitleClass::Deferrable, MAKEHOSVERSION(22,0,0)),
+    make_patch_entry<ns_patterns>("ns", 0x010000000000001F, TitleClass::Deferrable, MAKEHOSVERSION(9,0,0)),
+};
+
+struct EmummcPaths {
+    char unk[0x80];
+    char nintendo[0x80];
+};
+
+void smcAmsGetEmunandConfig(EmummcPaths* out_paths) {
+    SecmonArgs args{};
+    args.X[0] = 0xF0000404; /* smcAmsGetEmunandConfig */
+    args.X[1] = 0; /* EXO_EMUMMC_MMC_NAND*/
+    args.X[2] = (u64)out_paths; /* out path */
+    svcCallSecureMonitor(&args);
+}
+
+auto is_emummc() -> bool {
+    EmummcPaths paths{};
+    smcAmsGetEmunandConfig(&paths);
+    return (paths.unk[0] != '\0') || (paths.nintendo[0] != '\0');
+}
+
+auto is_version_skipped(const PatternMeta& p) -> bool {
+    return VERSION_SKIP &&
+        ((p.min_fw_ver && p.min_fw_ver > FW_VERSION) ||
+        (p.max_fw_ver && p.max_fw_ver < FW_VERSION) ||
+        (p.min_ams_ver && p.min_ams_ver > AMS_VERSION) ||
+        (p.max_ams_ver && p.max_ams_ver < AMS_VERSION));
+}
+
+// a patch found by the scan, they are all written once it is done.
+struct PendingWrite {
+    const PatternMeta* meta;
+    PatternState* state;
+    u64 inst_addr;
+    u64 patch_addr;
+    u32 inst; // as scanned, checked again before writing if the title was scanned detached
+};
+
+// writes to the same page are merged into one, this is the most that is written at once.
+constexpr u32 MAX_MERGED_WRITE = 0x1000 + MAX_PATTERN_SIZE;
+
+struct PendingWrites {
+    PendingWrite writes[MAX_PATTERNS_PER_TITLE];
+    u32 count;
+    u8 order[MAX_PATTERNS_PER_TITLE]; // indices into writes, by page
+};
+
+// returns true once the pattern no longer needs to be searched for, which is the
+// case from its match_index-th match on, whether or not that one could be patched.
+// the patch is queued, write_pending() writes it after the scan.
+auto on_match(PendingWrites& pending, const u8* data, u32 i, u64 addr, u64 base_addr, const HotRow& h, const PatternMeta& p, PatternState& s) -> bool {
+    if (s.match_count++ != p.match_index) {
+        return false;
+    }
+
+    // fetch the instruction
+    u32 inst{};
+    const auto inst_offset = i + h.inst_offset;
+    std::memcpy(&inst, data + inst_offset, sizeof(inst));
+
+    const auto patch_offset = addr + inst_offset + p.patch_offset;
+    const auto logged_offset = base_addr && patch_offset >= base_addr ? patch_offset - base_addr : patch_offset;
+
+    // prefer detecting an already-present patch before deciding to write one
+    if (p.patch.cmp(data + inst_offset + p.patch_offset)) {
+        // patch already applied by sigpatches / IPS
+        s.result = PatchResult::PATCHED_FILE;
+        s.logged_offset = logged_offset;
+        return true;
+    } else if (p.cond->matches(inst)) {
+        // write_pending() updates the result should the write fail.
+        pending.writes[pending.count++] = { &p, &s, addr + inst_offset, patch_offset, inst };
+        s.result = PatchResult::PATCHED_SYSPATCH;
+        s.logged_offset = logged_offset;
+        return true;
+    }
+
+    // only the match at match_index counts, so the pattern can't be found anymore.
+    return true;
+}
+
+// rows of a pattern and of every extension of it.
+auto family_rows(const PatchEntry& patch, u32 idx) -> u32 {
+    auto rows = patch.hot[idx].rows;
+    for (auto e = patch.hot[idx].extensions; e; e &= e - 1) {
+        rows |= patch.hot[std::countr_zero(e)].rows;
+    }
+    return rows;
+}
+
+// base patterns that still have a row to find, either directly or through an extension.
+auto active_bases(const PatchEntry& patch, u32 active) -> u32 {
+    u32 bases{};
+    for (u32 i = 0; i < patch.hot.size(); i++) {
+        const auto& h = patch.hot[i];
+        if (h.rows & active) {
+            bases |= 1U << (h.base == NO_BASE ? i : h.base);
+        }
+    }
+    return bases;
+}
+
+// rows whose window fits around start and whose instruction is aligned there.
+auto rows_at(const PatchEntry& patch, u32 rows, u32 start, u32 data_size, u64 addr) -> u32 {
+    u32 fits{};
+    for (; rows; rows &= rows - 1) {
+        const auto idx = std::countr_zero(rows);
+        const auto& r = patch.rows[idx];
+        if (start >= static_cast<u32>(-r.window.begin) && start + r.window.end <= data_size && is_inst_aligned(addr + start, r.inst_offset)) {
+            fits |= 1U << idx;
+        }
+    }
+    return fits;
+}
+
+struct ScanContext;
+
+// receives every match event, the rows whose pattern matched at start.
+// returns the rows that no longer need to be searched for.
+using MatchSink = u32 (*)(ScanContext& ctx, const u8* data, u32 start, u32 rows);
+
+// what an engine scans, and where its match events go.
+struct ScanContext {
+    const PatchEntry& patch;
+    MatchSink sink;
+    u64 addr; // address of data[0]
+    u64 base_addr; // start of the main module, offsets are logged relative to it
+    u32 active; // rows still searched for, cleared as the sink reports them done
+
+    // only used by the calibration sink
+    u32 events{};
+    u32 digest{};
+    u32 digest_end{}; // only events that start before this are part of the digest
+
+    // only used by the apply sink
+    PendingWrites* pending{};
+};
+
+// compares the base pattern idx at start, a match is reported for its rows and for the rows
+// of every extension that matches as well. returns the rows that no longer need to be searched for.
+auto on_candidate(ScanContext& ctx, const u8* data, u32 data_size, u32 start, u32 idx) -> u32 {
+    const auto& patch = ctx.patch;
+    const auto& h = patch.hot[idx];
+    const auto rows = rows_at(patch, family_rows(patch, idx) & ctx.active, start, data_size, ctx.addr);
+    if (!rows || !h.match(data + start)) {
+        return 0;
+    }
+
+    auto matched = h.rows & rows;
+    for (auto e = h.extensions; e; e &= e - 1) {
+        const auto& x = patch.hot[std::countr_zero(e)];
+        if ((x.rows & rows) && x.match(data + start)) {
+            matched |= x.rows & rows;
+        }
+    }
+    if (!matched) {
+        return 0;
+    }
+
+    const auto done = ctx.sink(ctx, data, start, matched);
+    ctx.active &= ~done;
+    return done;
+}
+
+// the sink used for scanning, queues the patch of every row that matched.
+auto apply_rows(ScanContext& ctx, const u8* data, u32 start, u32 rows) -> u32 {
+    u32 done{};
+    for (; rows; rows &= rows - 1) {
+        const auto i = std::countr_zero(rows);
+        if (on_match(*ctx.pending, data, start, ctx.addr, ctx.base_addr, ctx.patch.rows[i], ctx.patch.meta[i], ctx.patch.state[i])) {
+            done |= 1U << i;
+        }
+    }
+    return done;
+}
+
+// the sink used for calibration, only counts and digests the events, the digest doesn't
+// depend on the order in which they are reported.
+auto digest_rows(ScanContext& ctx, const u8*, u32 start, u32 rows) -> u32 {
+    if (start < ctx.digest_end) {
+        ctx.events++;
+        ctx.digest += (start * 0x9E3779B1U) ^ (rows * 0x85EBCA6BU);
+    }
+    return 0;
+}
+
+// scan position within the current memory region, carried over between chunks
+// so that every byte is only looked at once. what the cursor means is up to the engine.
+struct ScanStream {
+    u32 cursor{}; // next byte to feed the automaton, or next start to test
+    u32 state{}; // automaton state
+    bool single{}; // set once only one base pattern is left and the automaton is no longer used
+};
+
+// how far the windows of some rows reach around a start.
+struct RowReach {
+    u32 behind{~0U}; // fewest bytes any row needs before the start
+    u32 ahead{}; // most bytes any row needs from the start on
+    u32 shortest{~0U}; // fewest bytes any row needs from the start on
+    u32 phases{}; // alignment (inst_offset & 3) of each row, one bit per phase
+};
+
+auto row_reach(const PatchEntry& patch, u32 rows) -> RowReach {
+    RowReach r{};
+    for (; rows; rows &= rows - 1) {
+        const auto& row = patch.rows[std::countr_zero(rows)];
+        r.behind = std::min<u32>(r.behind, -row.window.begin);
+        r.ahead = std::max<u32>(r.ahead, row.window.end);
+        r.shortest = std::min<u32>(r.shortest, row.window.end);
+        r.phases |= 1U << (row.inst_offset & 3);
+    }
+    return r;
+}
+
+// the window of every row has to fit in the data, both behind and ahead of the start.
+// only at the end of the region are starts tested that leave some rows without room.
+// returns the end of the starts that can be tested now, 0 if none.
+auto starts_end(const RowReach& r, u32 data_size, bool region_end) -> u32 {
+    const auto reach = region_end ? r.shortest : r.ahead;
+    return data_size < reach ? 0 : data_size - reach + 1;
+}
+
+// tests the starts [begin, end) for base pattern idx, jumping between occurrences of its anchor
+// byte if that is rare enough, else stepping over the aligned starts only, unless the rows
+// disagree on the alignment. returns false once none of its rows are left.
+auto scan_base(ScanContext& ctx, const u8* data, u32 data_size, u32 idx, u32 phases, u32 begin, u32 end) -> bool {
+    const auto& pd = ctx.patch.hot[idx].pattern;
+    auto rows = family_rows(ctx.patch, idx) & ctx.active;
+
+    if (BYTE_RARITY[pd.anchor_value] >= MEMCHR_MIN_RARITY) {
+        for (u32 i = begin; i < end;) {
+            const auto hit = static_cast<const u8*>(std::memchr(data + i + pd.anchor_byte, pd.anchor_value, end - i));
+            if (!hit) {
+                break;
+            }
+
+            const u32 start = hit - data - pd.anchor_byte;
+            if (const auto done = on_candidate(ctx, data, data_size, start, idx)) {
+                if (!(rows &= ~done)) {
+                    return false;
+                }
+            }
+            i = start + 1;
+        }
+    } else {
+        const auto step = std::has_single_bit(phases) ? 4 : 1;
+        const auto phase = std::countr_zero(phases);
+        for (u32 start = step == 4 ? begin + ((first_aligned_index(ctx.addr, phase) - begin) & 3) : begin; start < end; start += step) {
+            if (const auto done = on_candidate(ctx, data, data_size, start, idx)) {
+                if (!(rows &= ~done)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// scans data[stream.cursor..data_size) and advances the cursor.
+// data[0..stream.cursor) holds bytes that were already scanned and are only kept so that
+// matches can read behind their start. candidates whose window doesn't fit in the
+// data yet are left for the next chunk, unless this is the end of the region.
+using ScanFn = void (*)(ScanContext& ctx, const u8* data, u32 data_size, bool region_end, ScanStream& stream);
+
+// feeds every byte through the automaton once, and switches to scan_base() once a single base
+// pattern is left.
+void scan_automaton(ScanContext& ctx, const u8* data, u32 data_size, bool region_end, ScanStream& stream) {
+    const auto& patch = ctx.patch;
+    auto bases = active_bases(patch, ctx.active);
+    if (!bases) {
+        stream.cursor = data_size;
+        return;
+    }
+
+    const auto& ac = patch.automaton;
+
+    // a single base pattern left, search only for it.
+    if (!(bases & (bases - 1))) {
+        const auto idx = std::countr_zero(bases);
+        const auto& h = patch.hot[idx];
+
+        // every pattern whose anchor ended before the cursor was already seen by the automaton.
+        if (!stream.single) {
+            stream.single = true;
+            stream.cursor = stream.cursor >= h.run_end ? stream.cursor + 1 - h.run_end : 0;
+        }
+
+        const auto reach = row_reach(patch, family_rows(patch, idx) & ctx.active);
+        const auto begin = std::max<u32>(stream.cursor, reach.behind);
+        const auto end = starts_end(reach, data_size, region_end);
+        if (!end) {
+            return;
+        }
+        stream.cursor = std::max(stream.cursor, end);
+        scan_base(ctx, data, data_size, idx, reach.phases, begin, end);
+        return;
+    }
+
+    // feed every byte through the automaton once, each hit gives the end of an
+    // anchor, from which the start of the full pattern is known.
+    // the last bytes are held back until the next chunk so that every hit has its window.
+    const auto feed_end = region_end ? data_size : data_size - std::min(data_size, ac.lookahead);
+    auto state = stream.state;
+    for (u32 i = stream.cursor; bases && i < feed_end; i++) {
+        state = ac.next[state * ac.num_classes + ac.byte_class[data[i]]];
+
+        for (auto hits = ac.out[state] & bases; hits; hits &= hits - 1) {
+            const auto idx = std::countr_zero(hits);
+            if (i + 1 < patch.hot[idx].run_end) {
+                continue;
+            }
+
+            // if we have found a matching pattern
+            if (on_candidate(ctx, data, data_size, i + 1 - patch.hot[idx].run_end, idx)) {
+                if (!(family_rows(patch, idx) & ctx.active)) {
+                    bases &= ~(1U << idx);
+                }
+            }
+        }
+    }
+    stream.state = state;
+    stream.cursor = std::max(stream.cursor, feed_end);
+}
+
+// runs scan_base() for every base pattern over the same starts, one pass per base.
+// fewer table lookups than the automaton when there are only a few bases with rare anchors.
+void scan_anchor(ScanContext& ctx, const u8* data, u32 data_size, bool region_end, ScanStream& stream) {
+    const auto& patch = ctx.patch;
+    const auto reach = row_reach(patch, ctx.active);
+    const auto end = starts_end(reach, data_size, region_end);
+    if (!end) {
+        return;
+    }
+
+    for (auto bases = active_bases(patch, ctx.active); bases; bases &= bases - 1) {
+        const auto idx = std::countr_zero(bases);
+        const auto family = row_reach(patch, family_rows(patch, idx) & ctx.active);
+        scan_base(ctx, data, data_size, idx, family.phases, std::max(stream.cursor, family.behind), end);
+    }
+    stream.cursor = std::max(stream.cursor, end);
+}
+
+// tests every start against every base pattern that has rows left. it shares nothing with
+// the other engines besides the matchers, so it is what they fall back to and are checked against.
+void scan_reference(ScanContext& ctx, const u8* data, u32 data_size, bool region_end, ScanStream& stream) {
+    const auto& patch = ctx.patch;
+    const auto end = starts_end(row_reach(patch, ctx.active), data_size, region_end);
+    if (!end) {
+        return;
+    }
+
+    for (u32 start = stream.cursor; ctx.active && start < end; start++) {
+        for (auto bases = active_bases(patch, ctx.active); bases; bases &= bases - 1) {
+            on_candidate(ctx, data, data_size, start, std::countr_zero(bases));
+        }
+    }
+    stream.cursor = std::max(stream.cursor, end);
+}
+
+struct ScanEngine {
+    const char* name;
+    ScanFn scan;
+};
+
+// engine numbers as used in config.ini, 0 picks one by calibration.
+constexpr u8 ENGINE_AUTO = 0;
+constexpr u8 ENGINE_REFERENCE = 1;
+constexpr ScanEngine ENGINES[] = {
+    { "reference", scan_reference },
+    { "automaton", scan_automaton },
+    { "anchor", scan_anchor },
+};
+
+constexpr auto engine(u8 number) -> const ScanEngine& {
+    return ENGINES[number - 1];
+}
+
+// runs engines over the first chunk of a title without applying anything, and returns the
+// number of the fastest. the reference engine is only timed if it was asked for, it can't be
+// faster. with cross_check set, the reference engine runs first and every engine that doesn't
+// report the same events is left out and added to patch.mismatched.
+auto calibrate(PatchEntry& patch, const u8* data, u32 data_size, bool region_end, u64 addr, bool cross_check) -> u8 {
+    // events that start this far before the end of the chunk were seen by every engine.
+    const auto digest_end = data_size - std::min(data_size, STREAM_HISTORY);
+    const auto active = patch.active;
+
+    const auto run = [&](u8 number, ScanContext& ctx) -> u64 {
+        ScanStream stream{};
+        const auto start = armGetSystemTick();
+        engine(number).scan(ctx, data, data_size, region_end, stream);
+        return armGetSystemTick() - start;
+    };
+
+    ScanContext reference{ patch, digest_rows, addr, 0, active, 0, 0, digest_end };
+    if (cross_check) {
+        run(ENGINE_REFERENCE, reference);
+    }
+
+    u8 best = ENGINE_REFERENCE;
+    u64 best_ticks = ~0ULL;
+    for (u8 number = 1; number <= std::size(ENGINES); number++) {
+        if (number == ENGINE_REFERENCE || (patch.engine != ENGINE_AUTO && number != patch.engine)) {
+            continue;
+        }
+
+        ScanContext ctx{ patch, digest_rows, addr, 0, active, 0, 0, digest_end };
+        const auto ticks = run(number, ctx);
+        if (cross_check && (ctx.events != reference.events || ctx.digest != reference.digest)) {
+            patch.mismatched |= 1U << number;
+            continue;
+        }
+        if (ticks < best_ticks) {
+            best = number;
+            best_ticks = ticks;
+        }
+    }
+    return best;
+}
+
+// works out once which rows of each title are searched for, from the toggles in config.ini and
+// the versions. rows that are out of date are marked as skipped, and titles with no rows left
+// are neither looked up nor attached to.
+void set_active_rows() {
+    for (auto& patch : patches) {
+        patch.active = 0;
+
+        // skip if version isn't valid
+        if (VERSION_SKIP &&
+            ((patch.min_fw_ver && patch.min_fw_ver > FW_VERSION) ||
+            (patch.max_fw_ver && patch.max_fw_ver < FW_VERSION))) {
+            for (auto& s : patch.state) {
+                s.result = PatchResult::SKIPPED;
+            }
+            continue;
+        }
+
+        for (u32 i = 0; i < patch.meta.size(); i++) {
+            auto& s = patch.state[i];
+            if (s.result == PatchResult::DISABLED) {
+                continue;
+            }
+            if (is_version_skipped(patch.meta[i])) {
+                s.result = PatchResult::SKIPPED;
+            } else {
+                patch.active |= 1U << i;
+            }
+        }
+    }
+}
+
+// returned by pm for a title that isn't running.
+constexpr Result PM_PROCESS_NOT_FOUND = MAKERESULT(15, 1);
+constexpr u32 MAX_PROCESSES = 0x80;
+
+// finds the pid of every title in patches[], so that only those processes are attached to.
+// pm knows the pid of every title, should it fail for any other reason than the title
+// not running, every process is attached to once instead to read its title id.
+void find_processes() {
+    bool sweep{};
+    for (auto& patch : patches) {
+        if (!patch.active) {
+            continue;
+        }
+        if (const auto rc = pmdmntGetProcessId(&patch.pid, patch.title_id); R_FAILED(rc)) {
+            patch.pid = 0;
+            sweep |= rc != PM_PROCESS_NOT_FOUND;
+        }
+    }
+
+    if (!sweep) {
+        return;
+    }
+
+    u64 pids[MAX_PROCESSES]{};
+    s32 process_count{};
+    if (R_FAILED(svcGetProcessList(&process_count, pids, MAX_PROCESSES))) {
+        return;
+    }
+
+    for (s32 i = 0; i < process_count; i++) {
+        Handle handle{};
+        DebugEventInfo event_info{};
+        if (R_FAILED(svcDebugActiveProcess(&handle, pids[i]))) {
+            continue;
+        }
+        if (R_SUCCEEDED(svcGetDebugEvent(&event_info, handle))) {
+            for (auto& patch : patches) {
+                if (patch.active && patch.title_id == event_info.info.create_process.program_id) {
+                    patch.pid = pids[i];
+                }
+            }
+        }
+        svcCloseHandle(handle);
+    }
+}
+
+// text segment of a module, these are the only regions that are scanned.
+struct CodeRegion {
+    u64 addr;
+    u64 size;
+    u64 build_id; // first 8 bytes of the module's build id, 0 if found by walking the address space
+};
+
+// rtld, main, up to 10 subsdks and sdk, with room to spare.
+constexpr u32 MAX_CODE_REGIONS = 16;
 
-constexpr auto ctest_cond(u32 inst) -> bool {
-    const auto type = inst >> 24;
-    return type == 0xF9 ||
-           type == 0xA9 ||
-           type == 0xF8;
+auto is_code_region(const MemoryInfo& mem_info) -> bool {
+    return mem_info.size && (mem_info.perm & Perm_Rx) == Perm_Rx && ((mem_info.type & 0xFF) == MemType_CodeStatic);
 }
 
-constexpr auto strb_cond(u32 inst) -> bool {
-    return (inst >> 24) == 0x39; // 68 02 00 39, strb w8, [x19]
-}
+// finds the text segment of every module of the process in address order, and the start of the
+// main module (the largest one) that offsets are logged relative to. the loader knows where each
+// module is, so that only takes a query per module. should that fail, the whole address space is
+// walked instead. returns the number of regions.
+// either svcQueryDebugProcessMemory() with a debug handle or svcQueryProcessMemory() with a process handle.
+using QueryFn = Result (*)(MemoryInfo* mem_info, u32* page_info, Handle handle, u64 addr);
+
+auto find_code_regions(Handle handle, QueryFn query, u64 pid, std::span<CodeRegion> out, u64& base_addr) -> u32 {
+    MemoryInfo mem_info{};
+    u32 page_info{};
+    u32 count{};
+
+    LoaderModuleInfo modules[MAX_CODE_REGIONS]{};
+    s32 module_count{};
+    if (LDR_DMNT && R_SUCCEEDED(ldrDmntGetProcessModuleInfo(pid, modules, std::size(modules), &module_count))) {
+        for (s32 i = 0; i < module_count && count < out.size(); i++) {
+            const auto& m = modules[i];
+            if (R_SUCCEEDED(query(&mem_info, &page_info, handle, m.base_address)) &&
+                mem_info.addr == m.base_address && is_code_region(mem_info)) {
+                u64 build_id{};
+                std::memcpy(&build_id, m.build_id, sizeof(build_id));
+                out[count++] = { mem_info.addr, mem_info.size, build_id };
+            }
+        }
+    }
 
-// to view patches, use https://armconverter.com/?lock=arm64
-constexpr PatchData ret0_patch_data{ "0xE0031F2A" };
-constexpr PatchData ret1_patch_data{ "0x200080D2" };
-constexpr PatchData mov0_ret_patch_data{ "0xE0031F2AC0035FD6" };
-constexpr PatchData nop_patch_data{ "0x1F2003D5" };
-//mov x0, xzr
-constexpr PatchData mov0_patch_data{ "0xE0031FAA" };
-//mov x2, xzr
-constexpr PatchData mov2_patch_data{ "0xE2031FAA" };
-constexpr PatchData cmp_patch_data{ "0x00" };
-constexpr PatchData ctest_patch_data{ "0x00309AD2001EA1F2610100D4E0031FAAC0035FD6" };
-constexpr PatchData strb0_patch_data{ "0x7F020039"};
-//strb wzr, [x19]
+    if (!count) {
+        for (u64 addr = 0; count < out.size();) {
+            if (R_FAILED(query(&mem_info, &page_info, handle, addr))) {
+                break;
+            }
+            addr = mem_info.addr + mem_info.size;
 
-constexpr auto ret0_patch(u32 inst) -> PatchData { return ret0_patch_data; }
-constexpr auto ret1_patch(u32 inst) -> PatchData { return ret1_patch_data; }
-constexpr auto mov0_ret_patch(u32 inst) -> PatchData { return mov0_ret_patch_data; }
-constexpr auto nop_patch(u32 inst) -> PatchData { return nop_patch_data; }
-constexpr auto mov0_patch(u32 inst) -> PatchData { return mov0_patch_data; }
-constexpr auto mov2_patch(u32 inst) -> PatchData { return mov2_patch_data; }
-constexpr auto cmp_patch(u32 inst) -> PatchData { return cmp_patch_data; }
-constexpr auto ctest_patch(u32 inst) -> PatchData { return ctest_patch_data; }
-constexpr auto strb0_patch(u32 inst) -> PatchData { return strb0_patch_data; }
+            // if addr=0 then we hit the reserved memory section
+            if (!addr) {
+                break;
+            }
+            // skip memory that we don't want
+            if (!is_code_region(mem_info)) {
+                continue;
+            }
+            out[count++] = { mem_info.addr, mem_info.size, 0 };
+        }
+    }
 
-constexpr auto ret0_applied(const u8* data, u32 inst) -> bool {
-    return ret0_patch(inst).cmp(data);
-}
+    std::sort(out.begin(), out.begin() + count, [](const CodeRegion& a, const CodeRegion& b) {
+        return a.addr < b.addr;
+    });
 
-constexpr auto ret1_applied(const u8* data, u32 inst) -> bool {
-    return ret1_patch(inst).cmp(data);
+    // Log offsets relative to the main module rather than the first executable region.
+    u64 base_size{};
+    for (u32 i = 0; i < count; i++) {
+        if (out[i].size > base_size) {
+            base_addr = out[i].addr;
+            base_size = out[i].size;
+        }
+    }
+    return count;
 }
 
-constexpr auto nop_applied(const u8* data, u32 inst) -> bool {
-    return nop_patch(inst).cmp(data);
-}
+// maps a code region of the process into our address space, so that it can be scanned in
+// place rather than copied out. svcMapProcessMemory maps it read-write, only the pointer
+// returned is const, and patches still go through svcWriteDebugProcessMemory.
+// returns nullptr if it couldn't be mapped.
+auto map_region(Handle process, const CodeRegion& region) -> const u8* {
+    if (!process) {
+        return nullptr;
+    }
 
-constexpr auto cmp_applied(const u8* data, u32 inst) -> bool {
-    return cmp_patch(inst).cmp(data);
+    // the address has to stay free until it is mapped, so both happen under the lock.
+    virtmemLock();
+    auto dst = virtmemFindAslr(region.size, 0);
+    if (dst && R_FAILED(svcMapProcessMemory(dst, process, region.addr, region.size))) {
+        dst = nullptr;
+    }
+    virtmemUnlock();
+    return static_cast<const u8*>(dst);
 }
 
-constexpr auto mov0_ret_applied(const u8* data, u32 inst) -> bool {
-    return mov0_ret_patch(inst).cmp(data);
+void unmap_region(Handle process, const CodeRegion& region, const u8* mapped) {
+    svcUnmapProcessMemory(const_cast<u8*>(mapped), process, region.addr, region.size);
 }
 
-constexpr auto mov0_applied(const u8* data, u32 inst) -> bool {
-    return mov0_patch(inst).cmp(data);
+// buffers of the threads that patch titles. they are handed out by patch_titles() to the
+// threads that take part, from default_worker_memory or the heap, see patch_titles().
+u8* worker_memory{};
+u32 worker_memory_size{};
+u32 worker_memory_used{};
+
+// nullptr if there's no room left. only called before any thread is started.
+auto take_worker_memory(u32 size, u32 align) -> u8* {
+    const auto offset = (worker_memory_used + align - 1) & ~(align - 1);
+    if (offset + size > worker_memory_size) {
+        return nullptr;
+    }
+    worker_memory_used = offset + size;
+    return worker_memory + offset;
 }
 
-constexpr auto mov2_applied(const u8* data, u32 inst) -> bool {
-    return mov2_patch(inst).cmp(data);
-}
+// chunks are read in after room for the bytes kept from the previous chunk, the extra
+// VECTOR_SIZE is never read into, it only keeps the vector compares in bounds.
+struct ReadSlot {
+    u8* bytes; // read_slot_size() of them
+    u64 addr;
+    u32 size; // 0 if the read failed
 
-constexpr auto ctest_applied(const u8* data, u32 inst) -> bool {
-    return ctest_patch(inst).cmp(data);
-}
+    auto data() -> u8* { return bytes + STREAM_HISTORY; }
+};
 
-constexpr auto strb0_applied(const u8* data, u32 inst) -> bool {
-    return strb0_patch(inst).cmp(data);
+// the first slot is also where writes are merged, see step_title().
+auto read_slot_size() -> u32 {
+    return std::max(STREAM_HISTORY + READ_SIZE + VECTOR_SIZE, MAX_MERGED_WRITE);
 }
 
-// patterns should be optimized in such a manner that they yield only one result, unless match_index selects a specific result.
-// patterns might yield results for more firmware versions, but if it yields more than one result (per firmware version), it should be condensed to near similar versions instead which only yields one result.
-// a pattern should not contain the bytes being patched, they should be wildcarded.
-// if the bytes being patched align with the patch partially, then the partial bytes can be in the pattern, the same applies to if the pattern contains the length of the patch.
-// the bytes being tested are defined by the _cond, and does not need to be in the pattern, and shouldn't be in the pattern, if the bytes being tested are also the bytes being patched.
-// () indicate testing, {} indicate what is being patched
-// example:
-// "0x00....0240F9........E8", 6, 0,
-// the bytes being tested, and patch size is the same, 6 from start of pattern, then patch 0 from start of where the test was designated:
-// "0x00....0240F9{(........)}E8"
-// if moving the head from what is being tested, the bytes, if in pattern, should be wildcarded by the length of the patch being applied
-// "0x00....0240F9........E8C8FE4739", 6, 4,
-// example {} should be wildcarded, as those are the bytes being patched, the bytes being tested can in that context contain bytes in the pattern:
-// "0x00....0240F9(......94){E8C8FE47}39", 6, 4,
-// example with wildcarding:
-// "0x00....0240F9(......94){........}39", 6, 4,
-//
-// designing new patterns should ideally conform to specification above.
+// hands out the chunks of the regions that couldn't be mapped, in order. with read_ahead set,
+// a reader thread fills the next slot while the current one is scanned. the reader only
+// writes produced and the scan only writes consumed, each side sleeps on changed until the
+// other has moved on. the worker's priority changes with its titles and it may share a core
+// with the reader, so neither may spin waiting for the other to run.
+struct ChunkReader {
+    static constexpr u32 STACK_SIZE = 0x2000;
+
+    ReadSlot slots[2];
+    u32 num_slots; // 2 if it can read ahead, else every chunk is read into the first one
+    u8* stack; // of the reader thread, only set if it can read ahead
+    Thread thread;
+    Handle handle;
+    std::span<const CodeRegion> regions;
+    bool threaded;
+    Mutex lock; // guards produced, consumed and stop
+    CondVar changed; // signalled whenever one of them is set
+    u32 produced;
+    u32 consumed;
+    bool stop; // set by the scan once it doesn't take any more chunks
+
+    // sets value under the lock and wakes the other side.
+    template<typename T>
+    void publish(T& field, T value) {
+        mutexLock(&lock);
+        field = value;
+        condvarWakeAll(&changed);
+        mutexUnlock(&lock);
+    }
 
-constinit Patterns fs_patterns[] = {
-    { "noacidsigchk_1.0.0-9.2.0", "0xC8FE4739", -24, 0, bl_cond, ret0_patch, ret0_applied, true, 0, FW_VER_ANY, MAKEHOSVERSION(9,2,0) }, // moved to loader 10.0.0
-    { "noacidsigchk_1.0.0-9.2.0", "0x0210911F000072", -5, 0, bl_cond, ret0_patch, ret0_applied, true, 0, FW_VER_ANY, MAKEHOSVERSION(9,2,0) }, // moved to loader 10.0.0
-    { "noncasigchk_1.0.0-3.0.2", "0x88..42..58", -4, 0, tbz_cond, nop_patch, nop_applied, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(3,0,2) },
-    { "noncasigchk_4.0.0-16.1.0", "0x1E4839....00......0054", -17, 0, tbz_cond, nop_patch, nop_applied, true, 0, MAKEHOSVERSION(4,0,0), MAKEHOSVERSION(16,1,0) },
-    { "noncasigchk_17.0.0+", "0x0694....00..42..0091", -18, 0, tbz_cond, nop_patch, nop_applied, true, 0, MAKEHOSVERSION(17,0,0), FW_VER_ANY },
-    { "nocntchk_1.0.0-18.1.0", "0x40F9........081C00121F05", 2, 0, bl_cond, ret0_patch, ret0_applied, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(18,1,0) },
-    { "nocntchk_19.0.0+", "0x40F9............40B9091C", 2, 0, bl_cond, ret0_patch, ret0_applied, true, 0, MAKEHOSVERSION(19,0,0), FW_VER_ANY },
-};
+    // reads every region in the same chunks as the scan takes them.
+    static void reader_main(void* arg) {
+        auto& r = *static_cast<ChunkReader*>(arg);
+        u32 n{};
+        for (const auto& region : r.regions) {
+            for (u64 sz = 0; sz < region.size;) {
+                mutexLock(&r.lock);
+                while (n - r.consumed == r.num_slots && !r.stop) {
+                    condvarWait(&r.changed, &r.lock);
+                }
+                const auto stop = r.stop;
+                mutexUnlock(&r.lock);
+                if (stop) {
+                    return;
+                }
 
-constinit Patterns ldr_patterns[] = {
-    { "noacidsigchk_10.0.0+", "0x009401C0BE121F00", 6, 2, cmp_cond, cmp_patch, cmp_applied, true, 0, FW_VER_ANY }, // 1F00016B - cmp w0, w1 patched to 1F00006B - cmp w0, w0
-};
+                auto& slot = r.slots[n % r.num_slots];
+                const auto size = static_cast<u32>(std::min<u64>(READ_SIZE, region.size - sz));
+                slot.addr = region.addr + sz;
+                slot.size = R_SUCCEEDED(svcReadDebugProcessMemory(slot.data(), r.handle, region.addr + sz, size)) ? size : 0;
+                r.publish(r.produced, ++n);
 
-constinit Patterns erpt_patterns[] = {
-    { "no_erpt", "0xFD7B02A9FD830091F55B04A9", -4, 0, sub_cond, mov0_ret_patch, mov0_ret_applied, true, 0, FW_VER_ANY }, // FF4305D1 - sub sp, sp, #0x150 patched to E0031F2AC0035FD6 - mov w0, wzr, ret 
-};
+                // the scan gives up on the region as well.
+                if (!slot.size) {
+                    break;
+                }
+                sz += size;
+            }
+        }
+    }
 
-constinit Patterns es_patterns[] = {
-    { "es_1.0.0-8.1.1", "0x0091....0094..7E4092", 10, 0, es_cond, mov0_patch, mov0_applied, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(8,1,1) },
-    { "es_9.0.0-11.0.1", "0x00..........A0....D1....FF97", 14, 0, es_cond, mov0_patch, mov0_applied, true, 0, MAKEHOSVERSION(9,0,0), MAKEHOSVERSION(11,0,1) },
-    { "es_12.0.0-18.1.0", "0x02........D2..52....0091", 32, 0, es_cond, mov0_patch, mov0_applied, true, 0, MAKEHOSVERSION(12,0,0), MAKEHOSVERSION(18,1,0) },
-    { "es_19.0.0-21.2.0", "0xA1........031F2A....0091", 32, 0, es_cond, mov0_patch, mov0_applied, true, 0, MAKEHOSVERSION(19,0,0), MAKEHOSVERSION(21,2,0) },
-    { "es_22.0.0+", "0xA0630091....FE97A08300D1....FE97", 16, 0, es_cond, mov0_patch, mov0_applied, true, 0, MAKEHOSVERSION(22,0,0), FW_VER_ANY },
-};
+    // takes the slot that chunks are read into, returns false if there's no room for it.
+    auto init() -> bool {
+        slots[0].bytes = take_worker_memory(read_slot_size(), 16);
+        num_slots = 1;
+        stack = nullptr;
+        return slots[0].bytes;
+    }
 
-constinit Patterns am_patterns[] = {
-    { "am_homebrew_fix_22.0.0+", "0x682646391F0500716100005460420691794DFF97", 16, 0, bl_cond, nop_patch, nop_applied, true, 0, MAKEHOSVERSION(22,0,0), FW_VER_ANY },
-};
+    // takes the second slot and the stack of the reader thread, should they not fit
+    // every chunk is read as it is taken.
+    void init_read_ahead() {
+        const auto used = worker_memory_used;
+        stack = take_worker_memory(STACK_SIZE, 0x1000);
+        slots[1].bytes = take_worker_memory(read_slot_size(), 16);
+        if (!stack || !slots[1].bytes) {
+            worker_memory_used = used;
+            stack = nullptr;
+            return;
+        }
+        num_slots = 2;
+    }
 
-constinit Patterns olsc_patterns[] = {
-    { "olsc_6.0.0-14.1.2", "0x00..73....F9....4039", 42, 0, bl_cond, ret1_patch, ret1_applied, true, 0, MAKEHOSVERSION(6,0,0), MAKEHOSVERSION(14,1,2) },
-    { "olsc_15.0.0-18.1.0", "0x00..73....F9....4039", 38, 0, bl_cond, ret1_patch, ret1_applied, true, 0, MAKEHOSVERSION(15,0,0), MAKEHOSVERSION(18,1,0) },
-    { "olsc_19.0.0+", "0x00..73....F9....4039", 42, 0, bl_cond, ret1_patch, ret1_applied, true, 0, MAKEHOSVERSION(19,0,0), FW_VER_ANY },
-};
+    // starts the reader thread if threaded, otherwise every chunk is read as it is taken.
+    void begin(Handle h, std::span<const CodeRegion> r, bool threaded_) {
+        handle = h;
+        regions = r;
+        mutexInit(&lock);
+        condvarInit(&changed);
+        produced = 0;
+        consumed = 0;
+        stop = false;
+
+        threaded = false;
+        if (threaded_ && stack && R_SUCCEEDED(threadCreate(&thread, reader_main, this, stack, STACK_SIZE, READ_AHEAD_PRIORITY, READ_AHEAD_CORE))) {
+            threaded = R_SUCCEEDED(threadStart(&thread));
+            if (!threaded) {
+                threadClose(&thread);
+            }
+        }
+    }
 
-constinit Patterns nifm_patterns[] = {
-    { "ctest_1.0.0-19.0.1", "0x03..AAE003..AA......39....04F8........E0", -29, 0, ctest_cond, ctest_patch, ctest_applied, true, 0, FW_VER_ANY, MAKEHOSVERSION(19,0,1) },
-    { "ctest_20.0.0+", "0x03..AA......AA..................0314AA....14AA", -17, 0, ctest_cond, ctest_patch, ctest_applied, true, 0, MAKEHOSVERSION(20,0,0), FW_VER_ANY },
-};
+    // stops the reader thread, whether or not every chunk was taken.
+    void end() {
+        if (threaded) {
+            publish(stop, true);
+            threadWaitForExit(&thread);
+            threadClose(&thread);
+        }
+    }
 
-constinit Patterns nim_patterns[] = {
-    { "blankcal0crashfix_17.0.0+", "0x00351F2003D5..............................97....0094....00..........61", 6, 0, adr_cond, mov2_patch, mov2_applied, true, 0, MAKEHOSVERSION(17,0,0), FW_VER_ANY },
-    { "blockfirmwareupdates_1.0.0-5.1.0", "0x1139F3", -30, 0, block_fw_updates_cond, mov0_ret_patch, mov0_ret_applied, true, 0, MAKEHOSVERSION(1,0,0), MAKEHOSVERSION(5,1,0) },
-    { "blockfirmwareupdates_6.0.0-6.2.0", "0xF30301AA..4E", -40, 0, block_fw_updates_cond, mov0_ret_patch, mov0_ret_applied, true, 0, MAKEHOSVERSION(6,0,0), MAKEHOSVERSION(6,2,0) },
-    { "blockfirmwareupdates_7.0.0-10.2.0", "0xF30301AA014C", -36, 0, block_fw_updates_cond, mov0_ret_patch, mov0_ret_applied, true, 0, MAKEHOSVERSION(7,0,0), MAKEHOSVERSION(10,2,0) },
-    { "blockfirmwareupdates_11.0.0-11.0.1", "0x9AF0....................C0035FD6", 16, 0, block_fw_updates_cond, mov0_ret_patch, mov0_ret_applied, true, 0, MAKEHOSVERSION(11,0,0), MAKEHOSVERSION(11,0,1) },
-    { "blockfirmwareupdates_12.0.0+", "0x41....4C............C0035FD6", 14, 0, block_fw_updates_cond, mov0_ret_patch, mov0_ret_applied, true, 0, MAKEHOSVERSION(12,0,0), FW_VER_ANY },
-};
+    // the chunk at addr, nullptr if it couldn't be read. chunks are taken in the order they are
+    // read in, though the chunks of a skipped region are passed over.
+    auto take(u64 addr, u32 size) -> u8* {
+        auto n = consumed;
+        if (threaded) {
+            for (;; n++) {
+                mutexLock(&lock);
+                while (produced == n) {
+                    condvarWait(&changed, &lock);
+                }
+                mutexUnlock(&lock);
+                if (slots[n % num_slots].addr == addr) {
+                    break;
+                }
+                publish(consumed, n + 1);
+            }
+        } else {
+            auto& slot = slots[n % num_slots];
+            slot.addr = addr;
+            slot.size = R_SUCCEEDED(svcReadDebugProcessMemory(slot.data(), handle, addr, size)) ? size : 0;
+        }
 
-constinit Patterns ns_patterns[] = {
-    { "force_gamecard_region_to_global", "0x35E8134039F4031F..68020039", 9, 0, strb_cond, strb0_patch, strb0_applied, true, 1, MAKEHOSVERSION(9,0,0), FW_VER_ANY },
-};
+        if (!slots[n % num_slots].size) {
+            publish(consumed, n + 1);
+            return nullptr;
+        }
+        return slots[n % num_slots].data();
+    }
 
-// NOTE: add system titles that you want to be patched to this table.
-// a list of system titles can be found here https://switchbrew.org/wiki/Title_list
-constinit PatchEntry patches[] = {
-    { "fs", 0x0100000000000000, fs_patterns },
-    // ldr needs to be patched in fw 10+
-    { "ldr", 0x0100000000000001, ldr_patterns, MAKEHOSVERSION(10,0,0) },
-    // erpt no write patch
-    { "erpt", 0x010000000000002B, erpt_patterns, MAKEHOSVERSION(10,0,0) },
-    // es was added in fw 2
-    { "es", 0x0100000000000033, es_patterns, MAKEHOSVERSION(2,0,0) },
-    // olsc was added in fw 6
-    { "olsc", 0x010000000000003E, olsc_patterns, MAKEHOSVERSION(6,0,0) },
-    { "nifm", 0x010000000000000F, nifm_patterns },
-    { "nim", 0x0100000000000025, nim_patterns },
-    { "am", 0x0100000000000023, am_patterns, MAKEHOSVERSION(22,0,0) },
-    { "ns", 0x010000000000001F, ns_patterns, MAKEHOSVERSION(9,0,0) },
+    // moves the last keep bytes before end in front of the next chunk and frees the current one.
+    void release(const u8* end, u32 keep) {
+        const auto n = consumed;
+        std::memmove(slots[(n + 1) % num_slots].data() - keep, end - keep, keep);
+        publish(consumed, n + 1);
+    }
 };
 
-struct EmummcPaths {
-    char unk[0x80];
-    char nintendo[0x80];
-};
+// attaches to the title and checks that the pid still belongs to it, the time spent
+// attached is added to patch.debug_ticks by detach().
+auto attach(PatchEntry& patch, Handle& handle, u64& attached_tick) -> bool {
+    DebugEventInfo event_info{};
+    if (R_FAILED(svcDebugActiveProcess(&handle, patch.pid))) {
+        return false;
+    }
+    attached_tick = armGetSystemTick();
 
-void smcAmsGetEmunandConfig(EmummcPaths* out_paths) {
-    SecmonArgs args{};
-    args.X[0] = 0xF0000404; /* smcAmsGetEmunandConfig */
-    args.X[1] = 0; /* EXO_EMUMMC_MMC_NAND*/
-    args.X[2] = (u64)out_paths; /* out path */
-    svcCallSecureMonitor(&args);
+    // the pid could have been reused by another title since it was looked up
+    if (R_FAILED(svcGetDebugEvent(&event_info, handle)) || patch.title_id != event_info.info.create_process.program_id) {
+        svcCloseHandle(handle);
+        patch.debug_ticks += armGetSystemTick() - attached_tick;
+        return false;
+    }
+    return true;
 }
 
-auto is_emummc() -> bool {
-    EmummcPaths paths{};
-    smcAmsGetEmunandConfig(&paths);
-    return (paths.unk[0] != '\0') || (paths.nintendo[0] != '\0');
+void detach(PatchEntry& patch, Handle handle, u64 attached_tick) {
+    svcCloseHandle(handle);
+    patch.debug_ticks += armGetSystemTick() - attached_tick;
 }
 
-void patcher(Handle handle, const u8* data, size_t data_size, u64 addr, u64 base_addr, std::span<Patterns> patterns) {
-    for (auto& p : patterns) {
-        // skip if disabled (controller by config.ini)
-        if (p.result == PatchResult::DISABLED) {
-            continue;
+// writes the patches queued by the scan. the patches that land on the same page are written
+// together, the bytes between them are read in first so that they are written back as is.
+// should that fail, each of them is written on its own so that the failure is put down to
+// the right patch. with verify set, the instruction of every patch is read back first, in
+// case the code changed since it was scanned. that is done for all of them before any is
+// written, as a patch may cover the instruction of another. merged holds MAX_MERGED_WRITE bytes.
+void write_pending(Handle handle, PendingWrites& pending, u8* merged, bool verify) {
+    auto& writes = pending.writes;
+    if (verify) {
+        for (u32 i = 0; i < pending.count; i++) {
+            u32 inst{};
+            if (R_FAILED(svcReadDebugProcessMemory(&inst, handle, writes[i].inst_addr, sizeof(inst))) || inst != writes[i].inst) {
+                writes[i].state->result = PatchResult::NOT_FOUND;
+            }
         }
+    }
 
-        // skip if version isn't valid
-        if (VERSION_SKIP &&
-            ((p.min_fw_ver && p.min_fw_ver > FW_VERSION) ||
-            (p.max_fw_ver && p.max_fw_ver < FW_VERSION) ||
-            (p.min_ams_ver && p.min_ams_ver > AMS_VERSION) ||
-            (p.max_ams_ver && p.max_ams_ver < AMS_VERSION))) {
-            p.result = PatchResult::SKIPPED;
-            continue;
+    // by page, then in the order they were found, which is the order they are applied in
+    const auto order = std::span{ pending.order, pending.count };
+    for (u32 i = 0; i < pending.count; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](u8 a, u8 b) {
+        const auto page_a = writes[a].patch_addr >> 12;
+        const auto page_b = writes[b].patch_addr >> 12;
+        return page_a != page_b ? page_a < page_b : a < b;
+    });
+
+    for (u32 i = 0, next; i < pending.count; i = next) {
+        const auto page = writes[order[i]].patch_addr >> 12;
+        u64 begin{~0ULL};
+        u64 end{};
+        for (next = i; next < pending.count && writes[order[next]].patch_addr >> 12 == page; next++) {
+            const auto& w = writes[order[next]];
+            if (w.state->result == PatchResult::PATCHED_SYSPATCH) {
+                begin = std::min(begin, w.patch_addr);
+                end = std::max(end, w.patch_addr + w.meta->patch.size);
+            }
         }
 
-        // skip if already patched
-        if (p.result == PatchResult::PATCHED_FILE || p.result == PatchResult::PATCHED_SYSPATCH) {
+        // nothing left on the page after verifying
+        if (begin >= end) {
             continue;
         }
 
-        for (u32 i = 0; i < data_size; i++) {
-            if (i + p.byte_pattern.size >= data_size) {
-                break;
+        const auto size = end - begin;
+        if (next - i > 1 && R_SUCCEEDED(svcReadDebugProcessMemory(merged, handle, begin, size))) {
+            for (u32 j = i; j < next; j++) {
+                const auto& w = writes[order[j]];
+                if (w.state->result == PatchResult::PATCHED_SYSPATCH) {
+                    std::memcpy(merged + (w.patch_addr - begin), w.meta->patch.data(), w.meta->patch.size);
+                }
             }
+            if (R_SUCCEEDED(svcWriteDebugProcessMemory(handle, merged, begin, size))) {
+                continue;
+            }
+        }
 
-            // loop through every byte of the pattern data to find a match
-            // skipping over any bytes if the value is REGEX_SKIP
-            u32 count{};
-            while (count < p.byte_pattern.size) {
-                if (p.byte_pattern.data[count] != data[i + count] && p.byte_pattern.data[count] != REGEX_SKIP) {
-                    break;
-                }
-                count++;
+        for (u32 j = i; j < next; j++) {
+            const auto& w = writes[order[j]];
+            // todo: log failed writes, although this should in theory never fail
+            if (w.state->result == PatchResult::PATCHED_SYSPATCH &&
+                R_FAILED(svcWriteDebugProcessMemory(handle, w.meta->patch.data(), w.patch_addr, w.meta->patch.size))) {
+                w.state->result = PatchResult::FAILED_WRITE;
             }
+        }
+    }
+}
 
-            // if we have found a matching pattern
-            if (count == p.byte_pattern.size) {
-                const auto match_addr = addr + i;
-                if (p.has_last_match && match_addr <= p.last_match_addr) {
-                    continue;
-                }
-                p.last_match_addr = match_addr;
-                p.has_last_match = true;
+// patching a title is split into steps, each of which does a bounded amount of work, so that
+// a thread can take turns between several titles, see worker_main().
+enum class TitleStep : u8 {
+    Open, // looks up the process, and its regions if it's to be scanned detached
+    Map, // maps the next region, only if it's to be scanned detached
+    Attach, // attaches to the title, unless every region was mapped
+    Scan, // scans the next chunk or slice of the current region
+    Write, // writes the queued patches, attaching for that if need be
+    Close, // unmaps the regions and closes the process
+    Done,
+};
 
-                if (p.match_count++ != p.match_index) {
-                    continue;
-                }
+// what is kept of a title between its steps.
+struct TitleTask {
+    PatchEntry* patch; // nullptr if the task is free
+    TitleStep step;
+    u64 spent_ticks; // time spent on the steps of the title, what its budget is checked against
+    bool patched; // false if the title couldn't be patched, such as when it exited
+    bool detached; // scanned through the mapped code without being attached to
+    bool calibrated;
+    Handle process;
+    Handle handle; // the debug handle, only set while attached
+    u64 attached_tick;
+    u64 base_addr;
+    u32 active; // rows still searched for
+    u32 region_count;
+    u32 region; // the region being mapped or scanned
+    u64 sz; // bytes of the region scanned so far
+    u32 kept; // bytes kept in front of the next chunk
+    ScanStream stream;
+    CodeRegion regions[MAX_CODE_REGIONS];
+    const u8* mapped[MAX_CODE_REGIONS];
+    PendingWrites pending;
+    u8 tail[STREAM_HISTORY + 2 * VECTOR_SIZE]; // the end of a mapped region and room for the compares past it, see scan_step()
+};
 
-                // fetch the instruction
-                u32 inst{};
-                const auto inst_offset = i + p.inst_offset;
-                std::memcpy(&inst, data + inst_offset, sizeof(inst));
+void start_title(TitleTask& t, PatchEntry& patch) {
+    t.patch = &patch;
+    t.step = TitleStep::Open;
+    t.spent_ticks = 0;
+    t.patched = true;
+    t.process = 0;
+    t.handle = 0;
+    t.base_addr = 0;
+    t.region_count = 0;
+    t.region = 0;
+    std::fill(std::begin(t.mapped), std::end(t.mapped), nullptr);
+}
 
-                const auto patch_offset = addr + inst_offset + p.patch_offset;
-                const auto logged_offset = base_addr && patch_offset >= base_addr ? patch_offset - base_addr : patch_offset;
+// whether the title ran out of its own budget, or patching as a whole ran out of time.
+// a title is only charged for its own steps, not for those of the titles it takes turns with.
+auto out_of_time(const TitleTask& t) -> bool {
+    return (TITLE_BUDGET && t.spent_ticks >= TITLE_BUDGET) || (DEADLINE_TICK && armGetSystemTick() >= DEADLINE_TICK);
+}
 
-                // prefer detecting an already-present patch before deciding to write one
-                if (p.applied(data + inst_offset + p.patch_offset, inst)) {
-                    // patch already applied by sigpatches / IPS
-                    p.result = PatchResult::PATCHED_FILE;
-                    p.logged_offset = logged_offset;
-                    break;
-                } else if (p.cond(inst)) {
-                    const auto patch_data = p.patch(inst);
-
-                    // todo: log failed writes, although this should in theory never fail
-                    if (R_FAILED(svcWriteDebugProcessMemory(handle, &patch_data, patch_offset, patch_data.size))) {
-                        p.result = PatchResult::FAILED_WRITE;
-                    } else {
-                        p.result = PatchResult::PATCHED_SYSPATCH;
-                    }
-                    p.logged_offset = logged_offset;
-                    break;
-                }
-            }
-        }
+// gives up on the rows that weren't found yet, the patches found so far are still written.
+void time_out(TitleTask& t, u32 rows) {
+    auto& patch = *t.patch;
+    for (; rows; rows &= rows - 1) {
+        patch.state[std::countr_zero(rows)].result = PatchResult::TIMED_OUT;
     }
+    patch.timed_out_ticks = t.spent_ticks;
 }
 
-auto apply_patch(PatchEntry& patch) -> bool {
-    Handle handle{};
-    DebugEventInfo event_info{};
+void next_region(TitleTask& t) {
+    t.region++;
+    t.sz = 0;
+}
 
-    u64 pids[0x50]{};
-    s32 process_count{};
-    constexpr u64 overlap_size = 0x4f;
-    static u8 buffer[READ_BUFFER_SIZE + overlap_size];
+// the engine is picked on the first chunk of the title, which is then scanned again.
+void scan_data(TitleTask& t, ScanContext& ctx, const u8* data, u32 data_size, bool region_end, u64 data_addr) {
+    auto& patch = *t.patch;
+    if (!t.calibrated) {
+        const auto size = std::min<u32>(data_size, READ_BUFFER_SIZE);
+        patch.engine = calibrate(patch, data, size, region_end && size == data_size, data_addr, ENGINE_CROSS_CHECK);
+        t.calibrated = true;
+    }
 
-    std::memset(buffer, 0, sizeof(buffer));
+    ctx.addr = data_addr;
+    engine(patch.engine).scan(ctx, data, data_size, region_end, t.stream);
+}
 
-    // skip if version isn't valid
-    if (VERSION_SKIP &&
-        ((patch.min_fw_ver && patch.min_fw_ver > FW_VERSION) ||
-        (patch.max_fw_ver && patch.max_fw_ver < FW_VERSION))) {
-        for (auto& p : patch.patterns) {
-            p.result = PatchResult::SKIPPED;
+// scans the next chunk of the current region, or the next slice of it if it is mapped.
+// stops as soon as every row has its result, which detaches from the title right away.
+void scan_step(TitleTask& t, ChunkReader& chunk_reader) {
+    if (t.region == t.region_count || !t.active) {
+        if (!t.detached) {
+            chunk_reader.end();
         }
-        return true;
+        t.step = TitleStep::Write;
+        return;
     }
 
-    if (R_FAILED(svcGetProcessList(&process_count, pids, 0x50))) {
-        return false;
+    // checked before every chunk, so that a title can't hold up the boot for long.
+    if (out_of_time(t)) {
+        time_out(t, t.active);
+        t.active = 0;
+        return;
+    }
+
+    auto& patch = *t.patch;
+    const auto& region = t.regions[t.region];
+    ScanContext ctx{ patch, apply_rows, 0, t.base_addr, t.active };
+    ctx.pending = &t.pending;
+
+    if (!t.sz) {
+        // none of the rows left fits in the region.
+        const auto reach = row_reach(patch, t.active);
+        if (region.size < reach.behind + reach.shortest) {
+            next_region(t);
+            return;
+        }
+
+        // patterns never span two regions, so each region starts a new stream.
+        t.stream = {};
+        t.kept = 0;
+        if (!t.mapped[t.region] && !t.detached) {
+            t.mapped[t.region] = map_region(t.process, region);
+        }
     }
 
-    for (auto& p : patch.patterns) {
-        p.match_count = 0;
-        p.last_match_addr = 0;
-        p.has_last_match = false;
-        p.logged_offset = 0;
-        if (p.result != PatchResult::DISABLED) {
-            p.result = PatchResult::NOT_FOUND;
+    // the mapped region is scanned in place, except for its last VECTOR_SIZE bytes as the
+    // vector compares would read past the mapping. the tail is copied into the buffer
+    // behind the bytes kept, and scanned as the end of the region. like a read slot, the tail
+    // has VECTOR_SIZE bytes after it that the compares may read.
+    if (const auto mapped = t.mapped[t.region]) {
+        const auto scan_end = region.size - VECTOR_SIZE;
+        if (t.sz < scan_end) {
+            const auto size = static_cast<u32>(std::min<u64>(MAPPED_SLICE, scan_end - t.sz));
+            const u32 data_size = t.kept + size;
+            scan_data(t, ctx, mapped + t.sz - t.kept, data_size, false, region.addr + t.sz - t.kept);
+            t.sz += size;
+
+            const auto keep = std::min(data_size, STREAM_HISTORY);
+            t.stream.cursor -= data_size - keep;
+            t.kept = keep;
+        } else {
+            std::memcpy(t.tail, mapped + t.sz - t.kept, t.kept + VECTOR_SIZE);
+            scan_data(t, ctx, t.tail, t.kept + VECTOR_SIZE, true, region.addr + t.sz - t.kept);
+            next_region(t);
         }
+        t.active = ctx.active;
+        return;
+    }
+
+    const auto actual_size = static_cast<u32>(std::min<u64>(READ_SIZE, region.size - t.sz));
+    const auto chunk = chunk_reader.take(region.addr + t.sz, actual_size);
+    if (!chunk) {
+        next_region(t);
+        return;
+    }
+
+    const u32 data_size = t.kept + actual_size;
+    t.sz += actual_size;
+    scan_data(t, ctx, chunk - t.kept, data_size, t.sz == region.size, region.addr + t.sz - data_size);
+    t.active = ctx.active;
+
+    // keep the tail for the next chunk, everything before the cursor has been scanned.
+    const auto keep = std::min(data_size, STREAM_HISTORY);
+    chunk_reader.release(chunk + actual_size, keep);
+    t.stream.cursor -= data_size - keep;
+    t.kept = keep;
+
+    if (t.sz == region.size) {
+        next_region(t);
     }
+}
+
+// runs the next step of the title. the chunk reader is only used while attached, and merged
+// only within a step, so both can be shared by the titles of a thread. merged is the first
+// slot of the reader, the reader is done with it by the time the patches are written.
+void step_title(TitleTask& t, ChunkReader& chunk_reader, u8* merged) {
+    auto& patch = *t.patch;
+    switch (t.step) {
+        case TitleStep::Open: {
+            // nothing to do, every row is disabled or skipped
+            if (!patch.active) {
+                t.step = TitleStep::Done;
+                break;
+            }
+
+            for (auto rows = patch.active; rows; rows &= rows - 1) {
+                patch.state[std::countr_zero(rows)] = {};
+            }
+
+            if (!patch.pid) {
+                t.patched = false;
+                t.step = TitleStep::Done;
+                break;
+            }
+
+            // patching ran out of time before the title was reached
+            if (out_of_time(t)) {
+                time_out(t, patch.active);
+                t.patched = false;
+                t.step = TitleStep::Done;
+                break;
+            }
+
+            // only needed to map the code, if that isn't possible it is read in chunks instead.
+            NcmProgramLocation location{};
+            if (MAP_MEMORY && R_FAILED(pmdmntAtmosphereGetProcessInfo(&t.process, &location, nullptr, patch.pid))) {
+                t.process = 0;
+            }
+
+            // the pid could have been reused by another title since it was looked up
+            if (t.process && location.program_id != patch.title_id) {
+                svcCloseHandle(t.process);
+                t.patched = false;
+                t.step = TitleStep::Done;
+                break;
+            }
 
-    for (s32 i = 0; i < (process_count - 1); i++) {
-        if (R_SUCCEEDED(svcDebugActiveProcess(&handle, pids[i])) &&
-            R_SUCCEEDED(svcGetDebugEvent(&event_info, handle)) &&
-            patch.title_id == event_info.info.create_process.program_id) {
-            MemoryInfo mem_info{};
-            u64 addr{};
-            u64 base_addr{};
-            u64 base_size{};
-            u32 page_info{};
+            // with short debug sessions the title is scanned through the mapped code without being
+            // attached to, it is only attached to at the end to write the patches. that needs every
+            // region to be mapped, else it's attached to for the whole scan.
+            t.detached = SHORT_DEBUG && t.process;
+            if (t.detached) {
+                t.region_count = find_code_regions(t.process, svcQueryProcessMemory, patch.pid, t.regions, t.base_addr);
+                t.detached = t.region_count != 0;
+            }
+            t.step = t.detached ? TitleStep::Map : TitleStep::Attach;
+        } break;
 
-            // Log offsets relative to the main module rather than the first executable region.
-            for (;;) {
-                if (R_FAILED(svcQueryDebugProcessMemory(&mem_info, &page_info, handle, addr))) {
+        case TitleStep::Map:
+            t.detached &= (t.mapped[t.region] = map_region(t.process, t.regions[t.region])) != nullptr;
+            if (++t.region == t.region_count) {
+                t.step = TitleStep::Attach;
+            }
+            break;
+
+        case TitleStep::Attach:
+            if (!t.detached) {
+                if (!attach(patch, t.handle, t.attached_tick)) {
+                    t.handle = 0;
+                    t.patched = false;
+                    t.step = TitleStep::Close;
                     break;
                 }
-                addr = mem_info.addr + mem_info.size;
 
-                // if addr=0 then we hit the reserved memory section
-                if (!addr) {
-                    break;
+                // found again through the debug handle should the process handle not have found any.
+                if (!t.region_count) {
+                    t.region_count = find_code_regions(t.handle, svcQueryDebugProcessMemory, patch.pid, t.regions, t.base_addr);
                 }
-                // skip memory that we don't want
-                if (!mem_info.size || (mem_info.perm & Perm_Rx) != Perm_Rx || ((mem_info.type & 0xFF) != MemType_CodeStatic)) {
-                    continue;
+
+                // with the process handle every region is mapped, so reading ahead is only worth it without.
+                chunk_reader.begin(t.handle, std::span{ t.regions, t.region_count }, READ_AHEAD && !t.process);
+            }
+
+            t.calibrated = patch.engine != ENGINE_AUTO && !ENGINE_CROSS_CHECK;
+            t.active = patch.active;
+            t.pending.count = 0;
+            t.region = 0;
+            t.sz = 0;
+            t.step = TitleStep::Scan;
+            break;
+
+        case TitleStep::Scan:
+            scan_step(t, chunk_reader);
+            break;
+
+        case TitleStep::Write:
+            // when detached, the title is only stopped for as long as it takes to write the patches.
+            if (!t.detached) {
+                write_pending(t.handle, t.pending, merged, false);
+                detach(patch, t.handle, t.attached_tick);
+                t.handle = 0;
+            } else if (t.pending.count) {
+                Handle handle{};
+                if (attach(patch, handle, t.attached_tick)) {
+                    write_pending(handle, t.pending, merged, true);
+                    detach(patch, handle, t.attached_tick);
+                } else {
+                    for (u32 i = 0; i < t.pending.count; i++) {
+                        t.pending.writes[i].state->result = PatchResult::FAILED_WRITE;
+                    }
                 }
+            }
+            t.step = TitleStep::Close;
+            break;
 
-                if (mem_info.size > base_size) {
-                    base_addr = mem_info.addr;
-                    base_size = mem_info.size;
+        case TitleStep::Close:
+            for (u32 r = 0; r < t.region_count; r++) {
+                if (t.mapped[r]) {
+                    unmap_region(t.process, t.regions[r], t.mapped[r]);
                 }
             }
+            if (t.process) {
+                svcCloseHandle(t.process);
+            }
+            t.step = TitleStep::Done;
+            break;
 
-            addr = 0;
-            std::memset(buffer, 0, sizeof(buffer));
+        case TitleStep::Done:
+            break;
+    }
+}
 
-            for (;;) {
-                if (R_FAILED(svcQueryDebugProcessMemory(&mem_info, &page_info, handle, addr))) {
-                    break;
-                }
-                addr = mem_info.addr + mem_info.size;
+// a thread that patches titles, each has its own buffers, see init_worker().
+struct Worker {
+    u8* stack; // not set for the main thread, which uses its own
+    Thread thread;
+    ChunkReader reader;
+    TitleTask* tasks; // TITLES_PER_THREAD of them
+};
 
-                // if addr=0 then we hit the reserved memory section
-                if (!addr) {
-                    break;
-                }
-                // skip memory that we don't want
-                if (!mem_info.size || (mem_info.perm & Perm_Rx) != Perm_Rx || ((mem_info.type & 0xFF) != MemType_CodeStatic)) {
+constexpr u32 WORKER_STACK_SIZE = 0x2000;
+
+// the main thread's buffers with the default options, nothing else is needed unless more is set.
+alignas(16) alignas(TitleTask) u8 default_worker_memory[sizeof(TitleTask) +
+    std::max<u32>(STREAM_HISTORY + READ_BUFFER_SIZE + VECTOR_SIZE, MAX_MERGED_WRITE) + 16];
+
+// the heap is set to this while titles are patched with more than the default options, it
+// can only be set in steps of 2mib. every thread has to fit whatever the options.
+constexpr u64 WORKER_HEAP_SIZE = 0x200000;
+static_assert(MAX_CORES * (WORKER_STACK_SIZE + ChunkReader::STACK_SIZE + 2 * 0x1000 +
+    MAX_TITLES_PER_THREAD * sizeof(TitleTask) + alignof(TitleTask) +
+    2 * (std::max(STREAM_HISTORY + MAX_READ_SIZE + VECTOR_SIZE, MAX_MERGED_WRITE) + 16)) <= WORKER_HEAP_SIZE);
+
+Worker workers[MAX_CORES]{}; // indexed by core
+
+// takes the buffers of a worker, and its stack if it runs on a thread of its own.
+// returns false if they don't fit, nothing is taken then.
+auto init_worker(Worker& w, bool own_thread) -> bool {
+    const auto used = worker_memory_used;
+    w.stack = own_thread ? take_worker_memory(WORKER_STACK_SIZE, 0x1000) : nullptr;
+    const auto tasks = take_worker_memory(TITLES_PER_THREAD * sizeof(TitleTask), alignof(TitleTask));
+    if ((own_thread && !w.stack) || !tasks || !w.reader.init()) {
+        worker_memory_used = used;
+        return false;
+    }
+
+    w.tasks = reinterpret_cast<TitleTask*>(tasks);
+    for (u32 i = 0; i < TITLES_PER_THREAD; i++) {
+        new (&w.tasks[i]) TitleTask{};
+    }
+    return true;
+}
+
+u8 title_order[std::size(patches)]{}; // indices into patches[], by class
+std::atomic<u32> next_title{}; // index into title_order of the next title to take
+
+// takes up to TITLES_PER_THREAD titles at a time and runs a step of each in turn, a new title
+// is taken as soon as one is done. a title is stopped while it is attached to, so from
+// attaching until detaching it's stepped on its own, which also leaves the reader to it.
+void worker_main(void* arg) {
+    auto& w = *static_cast<Worker*>(arg);
+    s32 priority{};
+    svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+    auto current_priority = priority;
+
+    for (;;) {
+        // the thread runs at the priority of the most important of its titles,
+        // within the range allowed by the npdm.
+        auto round_priority = 63;
+        bool running{};
+        for (u32 slot = 0; slot < TITLES_PER_THREAD; slot++) {
+            auto& t = w.tasks[slot];
+            if (!t.patch) {
+                const auto i = next_title.fetch_add(1, std::memory_order_relaxed);
+                if (i >= std::size(title_order)) {
                     continue;
                 }
+                start_title(t, patches[title_order[i]]);
+            }
+            const auto class_priority = WORKER_PRIORITY + TITLE_CLASS_PRIORITY[static_cast<u8>(t.patch->title_class)];
+            round_priority = std::min(round_priority, std::max(class_priority, 24));
+            running = true;
+        }
+        if (!running) {
+            break;
+        }
+        if (round_priority != current_priority) {
+            svcSetThreadPriority(CUR_THREAD_HANDLE, round_priority);
+            current_priority = round_priority;
+        }
 
-                for (u64 sz = 0; sz < mem_info.size; sz += READ_BUFFER_SIZE - overlap_size) {
-                    const auto actual_size = std::min(READ_BUFFER_SIZE, mem_info.size - sz);
-                    if (R_FAILED(svcReadDebugProcessMemory(buffer + overlap_size, handle, mem_info.addr + sz, actual_size))) {
-                        break;
-                    } else {
-                        patcher(handle, buffer, actual_size + overlap_size, mem_info.addr + sz - overlap_size, base_addr, patch.patterns);
-                        if (actual_size >= overlap_size) {
-                            memcpy(buffer, buffer + READ_BUFFER_SIZE, overlap_size);
-                            std::memset(buffer + overlap_size, 0, READ_BUFFER_SIZE);
-                        } else {
-                            const auto bytes_to_overlap = std::min<u64>(overlap_size, actual_size);
-                            memcpy(buffer, buffer + READ_BUFFER_SIZE + (actual_size - bytes_to_overlap), bytes_to_overlap);
-                            std::memset(buffer + bytes_to_overlap, 0, sizeof(buffer) - bytes_to_overlap);
-                        }
-                    }
+        for (u32 slot = 0; slot < TITLES_PER_THREAD; slot++) {
+            auto& t = w.tasks[slot];
+            if (!t.patch) {
+                continue;
+            }
+
+            do {
+                const auto tick = armGetSystemTick();
+                step_title(t, w.reader, w.reader.slots[0].bytes);
+                t.spent_ticks += armGetSystemTick() - tick;
+            } while (t.handle);
+
+            if (t.step == TitleStep::Done) {
+                if (t.patched && t.patch->active) {
+                    t.patch->done_tick = armGetSystemTick();
                 }
+                t.patch = nullptr;
             }
-            svcCloseHandle(handle);
-            return true;
-        } else if (handle) {
-            svcCloseHandle(handle);
-            handle = 0;
         }
     }
+    svcSetThreadPriority(CUR_THREAD_HANDLE, priority);
+}
+
+// patches every title, on the main thread and a thread for every other core in WORKER_CORES.
+// titles are taken by class, each thread takes the next title as soon as it's done with its
+// last one, so the small titles fill in around the big ones. a title is only ever touched by
+// the thread that took it. returns the number of threads that took part.
+auto patch_titles() -> u32 {
+    const auto main_core = svcGetCurrentProcessorNumber();
+    for (u32 i = 0; i < std::size(title_order); i++) {
+        title_order[i] = i;
+    }
+    std::sort(std::begin(title_order), std::end(title_order), [](u8 a, u8 b) {
+        return patches[a].title_class != patches[b].title_class ? patches[a].title_class < patches[b].title_class : a < b;
+    });
+    next_title.store(0, std::memory_order_relaxed);
+
+    // the default options fit in default_worker_memory, anything more is taken from the heap.
+    // should the heap not be there, the titles are patched with the default options instead.
+    void* heap{};
+    if ((WORKER_CORES & ~(1U << main_core)) || TITLES_PER_THREAD > 1 || READ_SIZE > READ_BUFFER_SIZE || READ_AHEAD) {
+        if (R_FAILED(svcSetHeapSize(&heap, WORKER_HEAP_SIZE))) {
+            heap = nullptr;
+            WORKER_CORES = 1U << main_core;
+            TITLES_PER_THREAD = 1;
+            READ_SIZE = READ_BUFFER_SIZE;
+            READ_AHEAD = false;
+        }
+    }
+    worker_memory = heap ? static_cast<u8*>(heap) : default_worker_memory;
+    worker_memory_size = heap ? WORKER_HEAP_SIZE : sizeof(default_worker_memory);
+    worker_memory_used = 0;
+
+    // buffers are only taken for the threads that take part, a core is left out should there
+    // be no room left for its thread. the buffers to read ahead are taken last, so that they
+    // never keep a thread from starting.
+    u32 cores = 1U << main_core;
+    init_worker(workers[main_core], false);
+    for (u32 core = 0; core < MAX_CORES; core++) {
+        if (core != main_core && (WORKER_CORES & (1U << core)) && init_worker(workers[core], true)) {
+            cores |= 1U << core;
+        }
+    }
+    if (READ_AHEAD) {
+        for (auto c = cores; c; c &= c - 1) {
+            workers[std::countr_zero(c)].reader.init_read_ahead();
+        }
+    }
+
+    u32 started{};
+    for (auto c = cores & ~(1U << main_core); c; c &= c - 1) {
+        const auto core = std::countr_zero(c);
+        auto& w = workers[core];
+        if (R_FAILED(threadCreate(&w.thread, worker_main, &w, w.stack, WORKER_STACK_SIZE, WORKER_PRIORITY, core))) {
+            continue;
+        }
+        if (R_FAILED(threadStart(&w.thread))) {
+            threadClose(&w.thread);
+            continue;
+        }
+        started |= 1U << core;
+    }
+
+    // the main thread takes titles as well, should no thread have started it takes them all.
+    worker_main(&workers[main_core]);
 
-    return false;
+    for (auto cores = started; cores; cores &= cores - 1) {
+        auto& w = workers[std::countr_zero(cores)];
+        threadWaitForExit(&w.thread);
+        threadClose(&w.thread);
+    }
+    if (heap) {
+        svcSetHeapSize(&heap, 0);
+    }
+    return 1 + std::popcount(started);
 }
 
 // creates a directory, non-recursive!
@@ -569,6 +2794,16 @@ auto ini_load_or_write_default(const char* section, const char* key, long _defau
     }
 }
 
+// same as above for values that aren't a toggle
+auto ini_load_or_write_default_number(const char* section, const char* key, long _default, const char* path) -> long {
+    if (!ini_haskey(section, key, path)) {
+        ini_putl(section, key, _default, path);
+        return _default;
+    } else {
+        return ini_getl(section, key, _default, path);
+    }
+}
+
 auto patch_result_to_str(PatchResult result) -> const char* {
     switch (result) {
         case PatchResult::NOT_FOUND: return "Unpatched";
@@ -577,6 +2812,7 @@ auto patch_result_to_str(PatchResult result) -> const char* {
         case PatchResult::PATCHED_FILE: return "Patched (file)";
         case PatchResult::PATCHED_SYSPATCH: return "Patched (sys-patch)";
         case PatchResult::FAILED_WRITE: return "Failed (svcWriteDebugProcessMemory)";
+        case PatchResult::TIMED_OUT: return "Timed out";
     }
 
     std::unreachable();
@@ -656,6 +2892,21 @@ void ms_2_str(char* s, u32 num) {
     *s++ = 's'; // in seconds
 }
 
+// the engine name, followed by the engines that failed the cross-check if any.
+void engine_to_log_str(char* s, u8 number, u8 mismatched) {
+    std::strcpy(s, engine(number).name);
+    if (mismatched) {
+        std::strcat(s, " (mismatch:");
+        for (u8 n = 1; n <= std::size(ENGINES); n++) {
+            if (mismatched & (1U << n)) {
+                std::strcat(s, " ");
+                std::strcat(s, engine(n).name);
+            }
+        }
+        std::strcat(s, ")");
+    }
+}
+
 // eg, 852481 -> 13.2.1
 void version_to_str(char* s, u32 ver) {
     for (int i = 0; i < 3; i++) {
@@ -705,13 +2956,27 @@ int main(int argc, char* argv[]) {
     const auto patch_emummc = ini_load_or_write_default("options", "patch_emummc", 1, ini_path);
     const auto enable_logging = ini_load_or_write_default("options", "enable_logging", 1, ini_path);
     VERSION_SKIP = ini_load_or_write_default("options", "version_skip", 1, ini_path);
+    ENGINE_CROSS_CHECK = ini_load_or_write_default("options", "engine_cross_check", 0, ini_path);
+    MAP_MEMORY = ini_load_or_write_default("options", "map_memory", 1, ini_path);
+    SHORT_DEBUG = ini_load_or_write_default("options", "short_debug", 1, ini_path);
+    READ_AHEAD = ini_load_or_write_default("options", "read_ahead", 0, ini_path);
+    READ_SIZE = std::clamp<long>(ini_load_or_write_default_number("options", "read_size", READ_BUFFER_SIZE, ini_path), 0x1000, MAX_READ_SIZE) & ~0xFFF;
+    WORKER_CORES = ini_load_or_write_default_number("options", "worker_cores", 1 << 3, ini_path);
+    WORKER_PRIORITY = ini_load_or_write_default_number("options", "worker_priority", 49, ini_path);
+    TITLES_PER_THREAD = std::clamp<long>(ini_load_or_write_default_number("options", "titles_per_thread", 1, ini_path), 1, MAX_TITLES_PER_THREAD);
+    const auto title_budget_ms = std::max<long>(ini_load_or_write_default_number("options", "title_budget_ms", 0, ini_path), 0);
+    const auto total_budget_ms = std::max<long>(ini_load_or_write_default_number("options", "total_budget_ms", 0, ini_path), 0);
+    TITLE_BUDGET = armNsToTicks(title_budget_ms * 1000000ULL);
 
     // load patch toggles
     for (auto& patch : patches) {
-        for (auto& p : patch.patterns) {
-            p.enabled = ini_load_or_write_default(patch.name, p.patch_name, p.enabled, ini_path);
-            if (!p.enabled) {
-                p.result = PatchResult::DISABLED;
+        const auto number = ini_load_or_write_default_number("engine", patch.name, ENGINE_AUTO, ini_path);
+        patch.engine = number > 0 && number <= static_cast<long>(std::size(ENGINES)) ? number : ENGINE_AUTO;
+
+        for (u32 i = 0; i < patch.meta.size(); i++) {
+            const auto& p = patch.meta[i];
+            if (!ini_load_or_write_default(patch.name, p.patch_name, p.enabled, ini_path)) {
+                patch.state[i].result = PatchResult::DISABLED;
             }
         }
     }
@@ -731,11 +2996,15 @@ int main(int argc, char* argv[]) {
 
     // speedtest
     const auto ticks_start = armGetSystemTick();
+    if (total_budget_ms) {
+        DEADLINE_TICK = ticks_start + armNsToTicks(total_budget_ms * 1000000ULL);
+    }
 
+    u32 worker_count{};
     if (enable_patching) {
-        for (auto& patch : patches) {
-            apply_patch(patch);
-        }
+        set_active_rows();
+        find_processes();
+        worker_count = patch_titles();
     }
 
     const auto ticks_end = armGetSystemTick();
@@ -743,13 +3012,36 @@ int main(int argc, char* argv[]) {
 
     if (enable_logging) {
         for (auto& patch : patches) {
-            for (auto& p : patch.patterns) {
+            for (u32 i = 0; i < patch.state.size(); i++) {
+                auto& s = patch.state[i];
                 if (!enable_patching) {
-                    p.result = PatchResult::SKIPPED;
+                    s.result = PatchResult::SKIPPED;
                 }
                 char log_value[96]{};
-                patch_result_to_log_str(log_value, p.result, p.logged_offset);
-                ini_puts(patch.name, p.patch_name, log_value, log_path);
+                patch_result_to_log_str(log_value, s.result, s.logged_offset);
+
+                // how long the title was worked on before it was given up on
+                if (s.result == PatchResult::TIMED_OUT) {
+                    std::strcat(log_value, " (");
+                    ms_2_str(log_value + std::strlen(log_value), std::min<u64>(armTicksToNs(patch.timed_out_ticks)/1000ULL/1000ULL, 9999));
+                    std::strcat(log_value, ")");
+                }
+                ini_puts(patch.name, patch.meta[i].patch_name, log_value, log_path);
+            }
+
+            // engine used for the title, none was picked if it wasn't found
+            if (patch.engine != ENGINE_AUTO) {
+                char engine_value[64]{};
+                engine_to_log_str(engine_value, patch.engine, patch.mismatched);
+                ini_puts("engine", patch.name, engine_value, log_path);
+            }
+
+            // when the title was done, from the start of patching
+            if (patch.done_tick) {
+                char done_time[20]{};
+                ms_2_str(done_time, (armTicksToNs(patch.done_tick) - armTicksToNs(ticks_start))/1000ULL/1000ULL);
+                ini_puts("done", patch.name, done_time, log_path);
+                ini_putl("debug_us", patch.name, armTicksToNs(patch.debug_ticks)/1000ULL, log_path);
             }
         }
 
@@ -785,7 +3077,8 @@ int main(int argc, char* argv[]) {
         ini_puts("stats", "ams_hash", ams_hash, log_path);
         ini_putl("stats", "is_emummc", emummc, log_path);
         ini_putl("stats", "heap_size", INNER_HEAP_SIZE, log_path);
-        ini_putl("stats", "buffer_size", READ_BUFFER_SIZE, log_path);
+        ini_putl("stats", "buffer_size", READ_SIZE, log_path);
+        ini_putl("stats", "workers", worker_count, log_path);
         ini_puts("stats", "patch_time", patch_time, log_path);
     }
 
@@ -855,12 +3148,18 @@ void __appInit(void) {
     if (R_FAILED(rc = pmdmntInitialize()))
         fatalThrow(rc);
 
+    // optional, the memory of each process is walked instead if it's missing.
+    LDR_DMNT = R_SUCCEEDED(ldrDmntInitialize());
+
     // Close the service manager session.
     smExit();
 }
 
 // Service deinitialization.
 void __appExit(void) {
+    if (LDR_DMNT) {
+        ldrDmntExit();
+    }
     pmdmntExit();
     fsExit();
 }
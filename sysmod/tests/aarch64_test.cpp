@@ -0,0 +1,260 @@
+// host test for aarch64.hpp, run with make -C sysmod/tests.
+// the text is hand assembled, the encodings were checked with llvm-mc -triple=aarch64.
+
+#include "../lib/aarch64.hpp"
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using namespace aarch64;
+
+int failed{};
+
+#define CHECK(x) do { if (!(x)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failed++; } } while (0)
+
+// above 4gib, so any address kept in 32 bits would be cut short.
+constexpr u64 BASE = 0x71'0000'4000;
+
+constexpr u32 NOP = 0xD503201F;
+
+constexpr u32 TEXT[] = {
+    0x14000004, // 0x00 b       #0x10
+    0x97FFFFFE, // 0x04 bl      #-0x8, below the text
+    0x54000040, // 0x08 b.eq    #0x8
+    0xB4FFFFA1, // 0x0c cbz     x1, #-0xc
+    0x36180102, // 0x10 tbz     w2, #3, #0x20
+    0x10FFF803, // 0x14 adr     x3, #-0x100, below the text
+    0xD0000004, // 0x18 adrp    x4, #0x2000
+    NOP,        // 0x1c
+    0x91004085, // 0x20 add     x5, x4, #0x10
+    0xF0FFFFE6, // 0x24 adrp    x6, #-0x1000, below the text
+    NOP,        // 0x28
+    0xF9400CC7, // 0x2c ldr     x7, [x6, #0x18]
+    0xB94008C8, // 0x30 ldr     w8, [x6, #0x8]
+    0x35FFFE69, // 0x34 cbnz    w9, #-0x34
+    0xB70FFFEA, // 0x38 tbnz    x10, #33, #-0x4
+    0x94000008, // 0x3c bl      #0x20
+    0x54FFFE21, // 0x40 b.ne    #-0x3c
+};
+
+constexpr Branch BRANCHES[] = {
+    { BASE + 0x00, BASE + 0x10, BranchKind::Jump },
+    { BASE + 0x04, BASE - 0x04, BranchKind::Call },
+    { BASE + 0x08, BASE + 0x10, BranchKind::Conditional },
+    { BASE + 0x0c, BASE + 0x00, BranchKind::Conditional },
+    { BASE + 0x10, BASE + 0x30, BranchKind::Conditional },
+    { BASE + 0x34, BASE + 0x00, BranchKind::Conditional },
+    { BASE + 0x38, BASE + 0x34, BranchKind::Conditional },
+    { BASE + 0x3c, BASE + 0x5c, BranchKind::Call },
+    { BASE + 0x40, BASE + 0x04, BranchKind::Conditional },
+};
+
+constexpr DataRef REFS[] = {
+    { BASE + 0x14, BASE - 0xec },
+    { BASE + 0x20, BASE + 0x2010 },
+    { BASE + 0x2c, BASE - 0x1000 + 0x18 },
+    { BASE + 0x30, BASE - 0x1000 + 0x08 },
+};
+
+auto as_bytes(std::span<const u32> insts) -> const u8* {
+    return reinterpret_cast<const u8*>(insts.data());
+}
+
+void check_index(const Index& index) {
+    CHECK(!index.overflowed());
+
+    const auto branches = index.branches();
+    CHECK(branches.size() == std::size(BRANCHES));
+    for (std::size_t i = 0; i < branches.size() && i < std::size(BRANCHES); i++) {
+        CHECK(branches[i].from == BRANCHES[i].from);
+        CHECK(branches[i].to == BRANCHES[i].to);
+        CHECK(branches[i].kind == BRANCHES[i].kind);
+    }
+
+    const auto refs = index.refs();
+    CHECK(refs.size() == std::size(REFS));
+    for (std::size_t i = 0; i < refs.size() && i < std::size(REFS); i++) {
+        CHECK(refs[i].from == REFS[i].from);
+        CHECK(refs[i].to == REFS[i].to);
+    }
+}
+
+void test_whole() {
+    Branch branches[16];
+    DataRef refs[16];
+    u64 functions[16];
+    Index index{ branches, refs, functions };
+    index.feed(as_bytes(TEXT), sizeof(TEXT), BASE);
+    index.finish();
+    check_index(index);
+
+    u64 out[4];
+    CHECK(index.callers_of(BASE - 0x04, out) == 1 && out[0] == BASE + 0x04);
+    CHECK(index.callers_of(BASE + 0x10, out) == 0); // only a jump goes there
+    CHECK(index.refs_to(BASE + 0x2010, out) == 1 && out[0] == BASE + 0x20);
+    CHECK(index.refs_to(BASE - 0xec, out) == 1 && out[0] == BASE + 0x14);
+
+    CHECK(index.function_containing(BASE - 0x08) == std::nullopt);
+    CHECK(index.function_containing(BASE - 0x04) == BASE - 0x04);
+    CHECK(index.function_containing(BASE + 0x40) == BASE - 0x04);
+    CHECK(index.function_containing(BASE + 0x5c) == BASE + 0x5c);
+}
+
+// every split of the text in two, the adrp + add and adrp + ldr pairs straddle most of them.
+void test_split() {
+    for (u32 at = 0; at <= sizeof(TEXT); at += 4) {
+        Branch branches[16];
+        DataRef refs[16];
+        Index index{ branches, refs };
+        index.feed(as_bytes(TEXT), at, BASE);
+        index.feed(as_bytes(TEXT) + at, sizeof(TEXT) - at, BASE + at);
+        check_index(index);
+    }
+
+    Branch branches[16];
+    DataRef refs[16];
+    Index index{ branches, refs };
+    for (u32 at = 0; at < sizeof(TEXT); at += 4) {
+        index.feed(as_bytes(TEXT) + at, 4, BASE + at);
+    }
+    check_index(index);
+}
+
+// an add is paired with an adrp up to PAIR_WINDOW instructions after it, and no further.
+void test_pair_window() {
+    constexpr u32 window = Decoder<void(*)(const Branch&), void(*)(const DataRef&)>::PAIR_WINDOW;
+    std::vector<u32> text;
+    text.push_back(0x9000000C); // adrp x12, #0
+    text.insert(text.end(), window - 1, NOP);
+    text.push_back(0x9100118D); // add x13, x12, #0x4
+    text.push_back(0x9000000E); // adrp x14, #0
+    text.insert(text.end(), window, NOP);
+    text.push_back(0x910011CF); // add x15, x14, #0x4
+
+    Branch branches[4];
+    DataRef refs[4];
+    Index index{ branches, refs };
+    index.feed(as_bytes(text), static_cast<u32>(text.size() * 4), BASE);
+    CHECK(index.refs().size() == 1);
+    CHECK(index.refs()[0].from == BASE + window * 4);
+    CHECK(index.refs()[0].to == BASE + 0x4);
+}
+
+// once the storage is full the rest is dropped, and it is flagged.
+void test_overflow() {
+    Branch branches[2];
+    DataRef refs[1];
+    u64 functions[1];
+    Index index{ branches, refs, functions };
+    index.feed(as_bytes(TEXT), sizeof(TEXT), BASE);
+    CHECK(index.overflowed());
+    CHECK(index.branches().size() == 2);
+    CHECK(index.branches()[1].to == BASE - 0x04);
+    CHECK(index.refs().size() == 1);
+    CHECK(index.refs()[0].to == BASE - 0xec);
+
+    // both calls fit in the branches of a larger index, but not in its functions.
+    Branch more_branches[16];
+    DataRef more_refs[16];
+    Index small_functions{ more_branches, more_refs, functions };
+    small_functions.feed(as_bytes(TEXT), sizeof(TEXT), BASE);
+    CHECK(!small_functions.overflowed());
+    small_functions.finish();
+    CHECK(small_functions.overflowed());
+    CHECK(small_functions.function_containing(BASE + 0x40) == BASE - 0x04);
+}
+
+// a page is dropped once its register is written, and only then.
+void test_written() {
+    constexpr u32 text[] = {
+        0x90000000, // 0x00 adrp    x0, #0
+        0xAA0103E0, // 0x04 mov     x0, x1
+        0x91001002, // 0x08 add     x2, x0, #4
+        0x90000001, // 0x0c adrp    x1, #0
+        0x94000040, // 0x10 bl      #0x100
+        0x91001022, // 0x14 add     x2, x1, #4
+        0x90000013, // 0x18 adrp    x19, #0
+        0x94000040, // 0x1c bl      #0x100
+        0x91001274, // 0x20 add     x20, x19, #4, x19 outlives the call
+        0x90000003, // 0x24 adrp    x3, #0
+        0xF9000083, // 0x28 str     x3, [x4]
+        0x91002065, // 0x2c add     x5, x3, #8
+        0x90000006, // 0x30 adrp    x6, #0
+        0xF80104C9, // 0x34 str     x9, [x6], #16
+        0x910010C8, // 0x38 add     x8, x6, #4
+    };
+
+    Branch branches[4];
+    DataRef refs[4];
+    Index index{ branches, refs };
+    index.feed(as_bytes(text), sizeof(text), BASE);
+    CHECK(index.refs().size() == 2);
+    CHECK(index.refs()[0].from == BASE + 0x20 && index.refs()[0].to == BASE + 0x4);
+    CHECK(index.refs()[1].from == BASE + 0x2c && index.refs()[1].to == BASE + 0x8);
+
+    // register 31 is left out, it never holds a page.
+    constexpr struct { u32 inst; u32 written; } cases[] = {
+        { NOP, 0 },
+        { 0x54000040, 0 }, // b.eq    #0x8
+        { 0xAA0103E0, 1U << 0 }, // mov     x0, x1
+        { 0x94000040, 0x4007FFFF }, // bl      #0x100
+        { 0xD63F0300, 0x4007FFFF }, // blr     x24
+        { 0xD4000021, 0xFF }, // svc     #0x1
+        { 0xF9000083, 0 }, // str     x3, [x4]
+        { 0xF80104C9, 1U << 6 }, // str     x9, [x6], #16
+        { 0xF8408CC7, 1U << 7 | 1U << 6 }, // ldr     x7, [x6, #8]!
+        { 0xA9402FEA, 1U << 10 | 1U << 11 }, // ldp     x10, x11, [sp]
+        { 0xA9BF35CC, 1U << 14 }, // stp     x12, x13, [x14, #-16]!
+        { 0xC85F7E0F, 1U << 15 }, // ldxr    x15, [x16]
+        { 0xD53BD051, 1U << 17 }, // mrs     x17, tpidr_el0
+        { 0x0E0C3C12, 1U << 18 }, // mov     w18, v0.s[1]
+        { 0x9E660015, 1U << 21 }, // fmov    x21, d0
+        { 0x3DC006C0, 0 }, // ldr     q0, [x22, #16]
+        { 0x58000057, 1U << 23 }, // ldr     x23, #8
+        { 0xB87B6B59, 1U << 25 }, // ldr     w25, [x26, x27]
+        { 0xF83C001D, 1U << 29 }, // ldadd   x28, x29, [x0]
+        { 0x4CDF7020, 1U << 1 }, // ld1     { v0.16b }, [x1], #16
+        { 0xD9400062, 1U << 2 }, // ldapur  x2, [x3]
+    };
+    for (const auto& c : cases) {
+        const auto written = written_registers(c.inst) & 0x7FFFFFFF;
+        if (written != c.written) {
+            std::printf("%08x: written %08x, expected %08x\n", c.inst, written, c.written);
+        }
+        CHECK(written == c.written);
+    }
+}
+
+void test_decode() {
+    // the furthest targets each branch can reach.
+    CHECK(decode_branch(BASE, 0x16000000)->to == BASE - 0x800'0000); // b #-128mib
+    CHECK(decode_branch(BASE, 0x95FFFFFF)->to == BASE + 0x7FF'FFFC); // bl #128mib-4
+    CHECK(decode_branch(BASE, 0x54800000)->to == BASE - 0x10'0000); // b.eq #-1mib
+    CHECK(decode_branch(BASE, 0x36040000)->to == BASE - 0x8000); // tbz w0, #0, #-32kib
+    CHECK(decode_branch(0x10, 0x17FFFFFC)->to == 0); // b #-0x10
+    CHECK(!decode_branch(BASE, NOP));
+
+    CHECK(decode_adr(BASE, 0x70000000) == BASE + 3); // adr x0, #3
+    CHECK(decode_adrp(BASE + 0xFFC, 0xF0FFFFE6) == BASE - 0x1000); // adrp x6, #-0x1000
+    CHECK(decode_adrp(BASE, 0x90800000) == BASE - 0x1'0000'0000); // adrp x0, #-4gib
+    CHECK(!decode_adr(BASE, 0xD0000004)); // adrp is not adr
+    CHECK(!decode_adrp(BASE, 0x10FFF803)); // and adr is not adrp
+}
+
+} // namespace
+
+int main() {
+    test_whole();
+    test_split();
+    test_pair_window();
+    test_overflow();
+    test_written();
+    test_decode();
+
+    if (failed) {
+        std::printf("aarch64_test: %d checks failed\n", failed);
+        return 1;
+    }
+    std::printf("aarch64_test: ok\n");
+}
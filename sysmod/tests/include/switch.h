@@ -0,0 +1,139 @@
+#pragma once
+
+// host stand-in for the parts of libnx that main.cpp uses, so that its scanner can be built
+// and tested on a host. only the declarations are here, libnx_stub.cpp defines them.
+
+#include <cstdint>
+#include <cstddef>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+typedef u32 Handle;
+
+#define R_FAILED(r) ((r) != 0)
+#define R_SUCCEEDED(r) ((r) == 0)
+#define MAKERESULT(module, description) ((((module) & 0x1FF)) | ((description) & 0x1FFF) << 9)
+#define MAKEHOSVERSION(major, minor, micro) ((((u32)(major) & 0xFF) << 16) | (((u32)(minor) & 0xFF) << 8) | ((u32)(micro) & 0xFF))
+
+#define FS_MAX_PATH 0x301
+#define CUR_THREAD_HANDLE 0xFFFF8000
+#define INVALID_HANDLE 0
+
+enum { Perm_None = 0, Perm_R = 1, Perm_W = 2, Perm_X = 4, Perm_Rw = 3, Perm_Rx = 5 };
+enum { MemType_Unmapped = 0, MemType_Io = 1, MemType_Normal = 2, MemType_CodeStatic = 3, MemType_CodeMutable = 4, MemType_Heap = 5 };
+enum { AppletType_None = -2 };
+
+typedef struct {
+    u64 addr;
+    u64 size;
+    u32 type;
+    u32 attr;
+    u32 perm;
+    u32 ipc_refcount;
+    u32 device_refcount;
+    u32 padding;
+} MemoryInfo;
+
+typedef struct {
+    u64 program_id;
+    u64 process_id;
+    char name[12];
+    u32 flags;
+    void* user_exception_context_address;
+} CreateProcessInfo;
+
+typedef struct {
+    u32 type;
+    u32 flags;
+    u64 thread_id;
+    union {
+        CreateProcessInfo create_process;
+        u8 raw[0x80];
+    } info;
+} DebugEventInfo;
+
+typedef struct { u64 X[8]; } SecmonArgs;
+typedef struct { u8 major, minor, micro; } SetSysFirmwareVersion;
+typedef int SplConfigItem;
+typedef struct { u32 session; } FsFileSystem;
+typedef struct { u32 session; } FsFile;
+typedef struct { u8 build_id[0x20]; u64 base_address; u64 size; } LoaderModuleInfo;
+typedef struct { u64 program_id; u8 storage_id; u8 pad[7]; } NcmProgramLocation;
+typedef struct { u64 keys_held; u64 flags; } CfgOverrideStatus;
+
+typedef void (*ThreadFunc)(void*);
+typedef struct { void* handle; } Thread;
+typedef u32 Mutex;
+typedef u32 CondVar;
+
+extern "C" {
+
+Result svcGetProcessList(s32* out_count, u64* pids, u32 max);
+Result svcDebugActiveProcess(Handle* debug, u64 pid);
+Result svcGetDebugEvent(DebugEventInfo* event, Handle debug);
+Result svcCloseHandle(Handle handle);
+Result svcQueryDebugProcessMemory(MemoryInfo* info, u32* page_info, Handle debug, u64 addr);
+Result svcReadDebugProcessMemory(void* buffer, Handle debug, u64 addr, u64 size);
+Result svcWriteDebugProcessMemory(Handle debug, const void* buffer, u64 addr, u64 size);
+Result svcQueryProcessMemory(MemoryInfo* info, u32* page_info, Handle process, u64 addr);
+Result svcMapProcessMemory(void* dst, Handle process, u64 src, u64 size);
+Result svcUnmapProcessMemory(void* dst, Handle process, u64 src, u64 size);
+Result svcCallSecureMonitor(SecmonArgs* args);
+Result svcSetHeapSize(void** out_addr, u64 size);
+Result svcGetThreadPriority(s32* priority, Handle handle);
+Result svcSetThreadPriority(Handle handle, u32 priority);
+u32 svcGetCurrentProcessorNumber(void);
+
+u64 armGetSystemTick(void);
+u64 armTicksToNs(u64 tick);
+u64 armNsToTicks(u64 ns);
+
+Result threadCreate(Thread* t, ThreadFunc entry, void* arg, void* stack_mem, size_t stack_sz, int prio, int cpuid);
+Result threadStart(Thread* t);
+Result threadWaitForExit(Thread* t);
+Result threadClose(Thread* t);
+
+void mutexInit(Mutex* m);
+void mutexLock(Mutex* m);
+void mutexUnlock(Mutex* m);
+void condvarInit(CondVar* c);
+Result condvarWait(CondVar* c, Mutex* m);
+Result condvarWakeAll(CondVar* c);
+
+void virtmemLock(void);
+void virtmemUnlock(void);
+void* virtmemFindAslr(size_t size, size_t guard_size);
+
+Result smInitialize(void);
+void smExit(void);
+Result fsInitialize(void);
+void fsExit(void);
+Result fsOpenSdCardFileSystem(FsFileSystem* out);
+Result fsFsCreateDirectory(FsFileSystem* fs, const char* path);
+void fsFsClose(FsFileSystem* fs);
+Result setsysInitialize(void);
+void setsysExit(void);
+Result setsysGetFirmwareVersion(SetSysFirmwareVersion* out);
+Result splInitialize(void);
+void splExit(void);
+Result splGetConfig(SplConfigItem item, u64* out);
+Result pmdmntInitialize(void);
+void pmdmntExit(void);
+Result pmdmntGetProcessId(u64* pid, u64 program_id);
+Result pmdmntAtmosphereGetProcessInfo(Handle* handle, NcmProgramLocation* loc, CfgOverrideStatus* status, u64 pid);
+Result ldrDmntInitialize(void);
+void ldrDmntExit(void);
+Result ldrDmntGetProcessModuleInfo(u64 pid, LoaderModuleInfo* out, size_t max, s32* num);
+
+void hosversionSet(u32 version);
+[[noreturn]] void fatalThrow(Result err);
+
+} // extern "C"
@@ -0,0 +1,92 @@
+// definitions for include/switch.h and minIni. the tests only call into the scanner,
+// so every service reports a failure and config.ini reads as empty.
+
+#include <switch.h>
+#include "minIni/minIni.h"
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+
+constexpr Result NOT_ON_HOST = MAKERESULT(1, 1);
+
+} // namespace
+
+extern "C" {
+
+Result svcGetProcessList(s32* out_count, u64*, u32) { *out_count = 0; return NOT_ON_HOST; }
+Result svcDebugActiveProcess(Handle*, u64) { return NOT_ON_HOST; }
+Result svcGetDebugEvent(DebugEventInfo*, Handle) { return NOT_ON_HOST; }
+Result svcCloseHandle(Handle) { return 0; }
+Result svcQueryDebugProcessMemory(MemoryInfo*, u32*, Handle, u64) { return NOT_ON_HOST; }
+Result svcReadDebugProcessMemory(void*, Handle, u64, u64) { return NOT_ON_HOST; }
+Result svcWriteDebugProcessMemory(Handle, const void*, u64, u64) { return NOT_ON_HOST; }
+Result svcQueryProcessMemory(MemoryInfo*, u32*, Handle, u64) { return NOT_ON_HOST; }
+Result svcMapProcessMemory(void*, Handle, u64, u64) { return NOT_ON_HOST; }
+Result svcUnmapProcessMemory(void*, Handle, u64, u64) { return NOT_ON_HOST; }
+Result svcCallSecureMonitor(SecmonArgs*) { return NOT_ON_HOST; }
+Result svcSetHeapSize(void**, u64) { return NOT_ON_HOST; }
+Result svcGetThreadPriority(s32* priority, Handle) { *priority = 49; return 0; }
+Result svcSetThreadPriority(Handle, u32) { return 0; }
+u32 svcGetCurrentProcessorNumber(void) { return 3; }
+
+// ticks are nanoseconds on the host.
+u64 armGetSystemTick(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+u64 armTicksToNs(u64 tick) { return tick; }
+u64 armNsToTicks(u64 ns) { return ns; }
+
+Result threadCreate(Thread*, ThreadFunc, void*, void*, size_t, int, int) { return NOT_ON_HOST; }
+Result threadStart(Thread*) { return NOT_ON_HOST; }
+Result threadWaitForExit(Thread*) { return NOT_ON_HOST; }
+Result threadClose(Thread*) { return NOT_ON_HOST; }
+
+// no thread is ever started, so there's nothing to wait for.
+void mutexInit(Mutex*) {}
+void mutexLock(Mutex*) {}
+void mutexUnlock(Mutex*) {}
+void condvarInit(CondVar*) {}
+Result condvarWait(CondVar*, Mutex*) { return 0; }
+Result condvarWakeAll(CondVar*) { return 0; }
+
+void virtmemLock(void) {}
+void virtmemUnlock(void) {}
+void* virtmemFindAslr(size_t, size_t) { return nullptr; }
+
+Result smInitialize(void) { return NOT_ON_HOST; }
+void smExit(void) {}
+Result fsInitialize(void) { return NOT_ON_HOST; }
+void fsExit(void) {}
+Result fsOpenSdCardFileSystem(FsFileSystem*) { return NOT_ON_HOST; }
+Result fsFsCreateDirectory(FsFileSystem*, const char*) { return NOT_ON_HOST; }
+void fsFsClose(FsFileSystem*) {}
+Result setsysInitialize(void) { return NOT_ON_HOST; }
+void setsysExit(void) {}
+Result setsysGetFirmwareVersion(SetSysFirmwareVersion*) { return NOT_ON_HOST; }
+Result splInitialize(void) { return NOT_ON_HOST; }
+void splExit(void) {}
+Result splGetConfig(SplConfigItem, u64*) { return NOT_ON_HOST; }
+Result pmdmntInitialize(void) { return NOT_ON_HOST; }
+void pmdmntExit(void) {}
+Result pmdmntGetProcessId(u64*, u64) { return NOT_ON_HOST; }
+Result pmdmntAtmosphereGetProcessInfo(Handle*, NcmProgramLocation*, CfgOverrideStatus*, u64) { return NOT_ON_HOST; }
+Result ldrDmntInitialize(void) { return NOT_ON_HOST; }
+void ldrDmntExit(void) {}
+Result ldrDmntGetProcessModuleInfo(u64, LoaderModuleInfo*, size_t, s32*) { return NOT_ON_HOST; }
+
+void hosversionSet(u32) {}
+void fatalThrow(Result) { std::abort(); }
+
+int ini_getbool(const char*, const char*, int value, const char*) { return value; }
+long ini_getl(const char*, const char*, long value, const char*) { return value; }
+int ini_haskey(const char*, const char*, const char*) { return 0; }
+int ini_putl(const char*, const char*, long, const char*) { return 0; }
+int ini_puts(const char*, const char*, const char*, const char*) { return 0; }
+bool ini_remove(const char*) { return false; }
+
+// set up by __libnx_initheap() on the console.
+char* fake_heap_start;
+char* fake_heap_end;
+
+} // extern "C"
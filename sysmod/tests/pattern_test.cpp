@@ -0,0 +1,212 @@
+// host test for pattern_matches() in main.cpp, run with make -C sysmod/tests.
+// it is built once for each vector width the host has, and compared with pattern_words_match()
+// and a byte loop over random patterns. the data and the arena end right before a page that
+// can't be read, so that any read past what the compares are allowed to read faults.
+
+#define main sys_patch_main
+#include "../src/main.cpp"
+#undef main
+
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+int failed{};
+
+#define CHECK(x) do { if (!(x)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failed++; } } while (0)
+
+// bytes pattern_matches() compares at once, data is only readable up to the pattern size rounded up to it.
+#if defined(__ARM_NEON)
+constexpr const char* PATH = "neon";
+constexpr u32 WIDTH = 16;
+#elif defined(__AVX2__)
+constexpr const char* PATH = "avx2";
+constexpr u32 WIDTH = 32;
+#elif defined(__SSE2__)
+constexpr const char* PATH = "sse2";
+constexpr u32 WIDTH = 16;
+#else
+constexpr const char* PATH = "scalar";
+constexpr u32 WIDTH = 8;
+#endif
+
+static_assert(WIDTH <= VECTOR_SIZE);
+
+// size bytes that can be read, followed by a page that can't.
+struct Guarded {
+    explicit Guarded(u32 size) {
+        const auto page = static_cast<u32>(sysconf(_SC_PAGESIZE));
+        length = (size + page - 1) / page * page + page;
+        base = static_cast<u8*>(mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (base == MAP_FAILED) {
+            std::abort();
+        }
+        end = base + length - page;
+        mprotect(end, page, PROT_NONE);
+    }
+
+    ~Guarded() {
+        munmap(base, length);
+    }
+
+    // size bytes that end at the page that can't be read.
+    auto last(u32 size) const -> u8* {
+        return end - size;
+    }
+
+    u8* base;
+    u8* end;
+    u32 length;
+};
+
+// a pattern with a nibble mask, as PatternData holds it.
+struct TestPattern {
+    std::vector<u8> value;
+    std::vector<u8> mask;
+    u8 anchor_byte;
+};
+
+auto random_pattern(std::mt19937& rng) -> TestPattern {
+    // sizes around the word and vector widths are where the tail handling matters.
+    u32 size = rng() % 2 ? 1 + rng() % MAX_PATTERN_SIZE : std::max<u32>(1, 8 * (rng() % 32) + rng() % 3 - 1);
+    size = std::min(size, MAX_PATTERN_SIZE);
+
+    TestPattern p{ std::vector<u8>(size), std::vector<u8>(size), static_cast<u8>(rng() % size) };
+    const auto wildcards = rng() % 4; // in quarters
+    for (u32 i = 0; i < size; i++) {
+        for (u32 shift : { 0, 4 }) {
+            if (rng() % 4 >= wildcards) {
+                p.mask[i] |= 0xF << shift;
+            }
+        }
+        p.value[i] = rng() & p.mask[i];
+    }
+    return p;
+}
+
+// packs p the way make_pattern_arena() does, after a pattern of junk so its offset isn't 0,
+// and before VECTOR_SIZE bytes of junk where the next pattern or the end of the arena would be.
+auto pack(const TestPattern& p, std::mt19937& rng, const Guarded& memory) -> std::pair<const u8*, PatternRef> {
+    const u32 size = p.value.size();
+    const u32 offset = rng() % 64;
+    const auto arena = memory.last(offset + packed_size(size) + VECTOR_SIZE);
+    for (u8* b = arena; b != memory.end; b++) {
+        *b = rng();
+    }
+
+    const auto value = arena + offset;
+    const auto bits = value + size;
+    std::memset(bits, 0, (size * 2 + 7) / 8);
+    for (u32 i = 0; i < size; i++) {
+        value[i] = p.value[i];
+        if (p.mask[i] & 0x0F) {
+            bits[i / 4] |= 1 << (i % 4 * 2);
+        }
+        if (p.mask[i] & 0xF0) {
+            bits[i / 4] |= 2 << (i % 4 * 2);
+        }
+    }
+    return { arena, PatternRef{ static_cast<u16>(offset), static_cast<u8>(size), p.anchor_byte, p.value[p.anchor_byte] } };
+}
+
+// data for p that ends the readable memory, after as many bytes of junk as the compares may read.
+// it mostly matches, and the rest of the time a single bit is off.
+auto place_data(const TestPattern& p, std::mt19937& rng, const Guarded& memory) -> const u8* {
+    const u32 size = p.value.size();
+    const auto data = memory.last((size + WIDTH - 1) / WIDTH * WIDTH);
+    for (u8* b = data; b != memory.end; b++) {
+        *b = rng();
+    }
+    if (rng() % 4) {
+        for (u32 i = 0; i < size; i++) {
+            data[i] = (data[i] & ~p.mask[i]) | p.value[i];
+        }
+        if (rng() % 2) {
+            data[rng() % size] ^= 1 << rng() % 8;
+        }
+    }
+    return data;
+}
+
+auto bytes_match(const TestPattern& p, const u8* data) -> bool {
+    for (u32 i = 0; i < p.value.size(); i++) {
+        if ((data[i] ^ p.value[i]) & p.mask[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_random() {
+    std::mt19937 rng(1);
+    Guarded arena_memory{ 0x1000 };
+    Guarded data_memory{ 0x1000 };
+    u32 matched{};
+    for (u32 it = 0; it < 200000; it++) {
+        const auto p = random_pattern(rng);
+        const auto [arena, ref] = pack(p, rng, arena_memory);
+        const auto data = place_data(p, rng, data_memory);
+
+        const auto expected = bytes_match(p, data);
+        matched += expected;
+        const auto vector = pattern_matches(data, arena, ref);
+        const auto words = pattern_words_match(data, arena, ref);
+        if ((vector != expected || words != expected) && failed < 20) {
+            std::printf("size %u, anchor %u: %s %d, words %d, expected %d\n", u32(ref.size), u32(ref.anchor_byte), PATH, vector, words, expected);
+        }
+        CHECK(vector == expected);
+        CHECK(words == expected);
+    }
+
+    // both outcomes have to be common, else the test says little.
+    CHECK(matched > 50000 && matched < 150000);
+}
+
+// every size, with the pattern ending right at the end of the data, and each byte off in turn.
+void test_every_size() {
+    std::mt19937 rng(2);
+    Guarded arena_memory{ 0x1000 };
+    Guarded data_memory{ 0x1000 };
+    for (u32 size = 1; size <= MAX_PATTERN_SIZE; size++) {
+        TestPattern p{ std::vector<u8>(size), std::vector<u8>(size, 0xFF), static_cast<u8>(size - 1) };
+        for (auto& v : p.value) {
+            v = rng();
+        }
+        const auto [arena, ref] = pack(p, rng, arena_memory);
+        const auto data = data_memory.last((size + WIDTH - 1) / WIDTH * WIDTH);
+        std::memcpy(data, p.value.data(), size);
+
+        CHECK(pattern_matches(data, arena, ref));
+        CHECK(pattern_words_match(data, arena, ref));
+        for (u32 i = 0; i < size; i++) {
+            data[i] ^= 0x10;
+            CHECK(!pattern_matches(data, arena, ref));
+            CHECK(!pattern_words_match(data, arena, ref));
+            data[i] ^= 0x10;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+#if defined(__AVX2__)
+    if (!__builtin_cpu_supports("avx2")) {
+        std::printf("pattern_test (%s): skipped, the host has no avx2\n", PATH);
+        return 0;
+    }
+#endif
+
+    test_random();
+    test_every_size();
+
+    if (failed) {
+        std::printf("pattern_test (%s): %d checks failed\n", PATH, failed);
+        return 1;
+    }
+    std::printf("pattern_test (%s): ok\n", PATH);
+}
@@ -0,0 +1,341 @@
+// host test for the scan engines in main.cpp, run with make -C sysmod/tests.
+// every engine is streamed over random regions in random chunks, and has to find the same
+// match of every row as the baseline scanner, which compares every pattern at every start.
+
+#define main sys_patch_main
+#include "../src/main.cpp"
+#undef main
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failed{};
+
+#define CHECK(x) do { if (!(x)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failed++; } } while (0)
+
+constexpr InstCond any_cond{ { 0, 0 } };
+
+// the pattern string of every row is kept apart, the baseline scanner reads them rather than the compiled tables.
+constexpr const char* first_strings[] = {
+    "0x11223344",
+    "0x11223344..66",
+    "0x1122..44",
+    "0x11223344....",
+    "0x99AA",
+    "0x99AABB",
+    "0x55..7.[88|99|AB]{1-3}CC",
+    "0xDD{0-4}EE{2}F.",
+};
+
+constexpr Patterns first_patterns[] = {
+    { "a", first_strings[0], 0, 0, any_cond, nop_patch, true, 0 },
+    { "b", first_strings[1], 8, 0, any_cond, nop_patch, true, 0 },
+    { "c", first_strings[2], 4, 0, any_cond, nop_patch, true, 2 },
+    { "d", first_strings[3], -2, 0, any_cond, nop_patch, true, 1 },
+    { "e", first_strings[4], 2, 0, any_cond, nop_patch, true, 3 },
+    { "f", first_strings[5], 1, 4, any_cond, nop_patch, true, 0 },
+    { "g", first_strings[6], -24, 0, any_cond, nop_patch, true, 0 },
+    { "h", first_strings[7], 0, -8, any_cond, nop_patch, true, 1 },
+};
+
+constexpr const char* second_strings[] = {
+    "0x11223344[55|57]",
+    "0x1122334455{1-2}[77|70|07]",
+    "0xABCD1.2.3.4.5.6.7.8.9.A.B.C.D.E.F.0.1.2.3.4.5.6.7.8.9.A.B.C.D.E.F.0.1.2.3.4.5.6.7.8.9.",
+    "0xABCD1.2.3.4.5.6.7.8.9.A.B.C.D.E.F.0.1.2.3.4.5.6.7.8.9.A.B.C.D.E.F.0.1.2.3.4.5.6.7.8.[90|91|A0]",
+    "0x00..73....F9....4039",
+    "0x00..73....F9....4039",
+    "0x1E4839....00......0054",
+};
+
+constexpr Patterns second_patterns[] = {
+    { "i", second_strings[0], 0, 0, any_cond, nop_patch, true, 0 },
+    { "j", second_strings[1], 0, 0, any_cond, nop_patch, true, 0 },
+    { "k", second_strings[2], 2, 0, any_cond, nop_patch, true, 0 },
+    { "l", second_strings[3], 0, 0, any_cond, nop_patch, true, 0 },
+    { "m", second_strings[4], 42, 0, bl_cond, ret1_patch, true, 0 },
+    { "n", second_strings[5], 38, 0, bl_cond, ret1_patch, true, 0 },
+    { "o", second_strings[6], -17, 0, tbz_cond, nop_patch, true, 0 },
+};
+
+// only bytes that are common in code, so that the starts are stepped over rather than searched for.
+constexpr const char* third_strings[] = {
+    "0xE003..AA",
+    "0xF9400094",
+    "0x1F..00F9{0-2}40",
+};
+
+constexpr Patterns third_patterns[] = {
+    { "p", third_strings[0], 0, 0, any_cond, nop_patch, true, 0 },
+    { "q", third_strings[1], -8, 0, any_cond, nop_patch, true, 1 },
+    { "r", third_strings[2], 2, 0, any_cond, nop_patch, true, 0 },
+};
+
+struct TestEntry {
+    PatchEntry patch;
+    std::span<const Patterns> patterns;
+    std::span<const char* const> strings;
+};
+
+// the entry of a test title, as make_patch_entry() makes it without checking STREAM_HISTORY.
+template<const auto& patterns, const auto& strings>
+auto make_test_entry(const char* name, u64 title_id) -> TestEntry {
+    using T = TitleTables<patterns>;
+    return {
+        { name, title_id, T::hot.patterns, T::hot.rows, T::meta, T::state, T::automaton.view(), TitleClass::Normal },
+        patterns, strings,
+    };
+}
+
+TestEntry entries[] = {
+    make_test_entry<first_patterns, first_strings>("first", 1),
+    make_test_entry<second_patterns, second_strings>("second", 2),
+    make_test_entry<third_patterns, third_strings>("third", 3),
+};
+
+auto nibble(char c) -> u8 {
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+auto parse_number(const char*& s) -> u32 {
+    u32 v{};
+    while (*s >= '0' && *s <= '9') {
+        v = v * 10 + (*s++ - '0');
+    }
+    return v;
+}
+
+// whether the pattern string s matches data at i, trying every length of every gap.
+auto string_matches(const char* s, const u8* data, u32 size, u32 i) -> bool {
+    if (*s == '\0') {
+        return true;
+    }
+    if (*s == '{') {
+        s++;
+        const auto min = parse_number(s);
+        const auto max = *s == '-' ? parse_number(++s) : min;
+        s++;
+        for (u32 gap = min; gap <= max; gap++) {
+            if (string_matches(s, data, size, i + gap)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (i >= size) {
+        return false;
+    }
+    if (*s == '[') {
+        bool hit{};
+        do {
+            s++;
+            hit |= (nibble(s[0]) << 4 | nibble(s[1])) == data[i];
+            s += 2;
+        } while (*s == '|');
+        return hit && string_matches(s + 1, data, size, i + 1);
+    }
+    for (u32 k = 0; k < 2; k++) {
+        if (s[k] != '.' && nibble(s[k]) != (data[i] >> (4 - 4 * k) & 0xF)) {
+            return false;
+        }
+    }
+    return string_matches(s + 2, data, size, i + 1);
+}
+
+// bytes that match the pattern string s, with a random length for every gap.
+void instance_of(const char* s, std::mt19937& rng, std::vector<u8>& out) {
+    s = skip_hex_prefix(s);
+    while (*s) {
+        if (*s == '{') {
+            s++;
+            const auto min = parse_number(s);
+            const auto max = *s == '-' ? parse_number(++s) : min;
+            s++;
+            for (auto gap = min + rng() % (max - min + 1); gap; gap--) {
+                out.push_back(rng());
+            }
+        } else if (*s == '[') {
+            std::vector<u8> options;
+            do {
+                s++;
+                options.push_back(nibble(s[0]) << 4 | nibble(s[1]));
+                s += 2;
+            } while (*s == '|');
+            s++;
+            out.push_back(options[rng() % options.size()]);
+        } else {
+            u8 v = rng();
+            for (u32 k = 0; k < 2; k++) {
+                if (s[k] != '.') {
+                    const auto shift = 4 - 4 * k;
+                    v = (v & ~(0xF << shift)) | nibble(s[k]) << shift;
+                }
+            }
+            out.push_back(v);
+            s += 2;
+        }
+    }
+}
+
+struct Found {
+    PatchResult result;
+    u64 logged_offset;
+};
+
+// the scanner as it was before the automaton: every pattern is compared at every start
+// in address order, and the match_index-th match of a row decides its result.
+// unlike it, a start at which the row's instruction isn't 4 byte aligned isn't counted,
+// no instruction can sit there.
+auto baseline_scan(const TestEntry& entry, const std::vector<u8>& region, u64 addr, u32 row) -> Found {
+    const auto& p = entry.patterns[row];
+    const auto& meta = entry.patch.meta[row];
+    const auto window = pattern_window(p);
+    const auto pattern = skip_hex_prefix(entry.strings[row]);
+
+    u32 count{};
+    for (u32 start = 0; start < region.size(); start++) {
+        if (static_cast<s64>(start) + window.begin < 0 || start + window.end > region.size() || !is_inst_aligned(addr + start, p.inst_offset)) {
+            continue;
+        }
+        if (!string_matches(pattern, region.data(), region.size(), start) || count++ != p.match_index) {
+            continue;
+        }
+
+        const auto inst_offset = start + p.inst_offset;
+        const auto logged_offset = addr + inst_offset + p.patch_offset;
+        u32 inst;
+        std::memcpy(&inst, region.data() + inst_offset, sizeof(inst));
+        if (meta.patch.cmp(region.data() + inst_offset + p.patch_offset)) {
+            return { PatchResult::PATCHED_FILE, logged_offset };
+        } else if (meta.cond->matches(inst)) {
+            return { PatchResult::PATCHED_SYSPATCH, logged_offset };
+        }
+        break;
+    }
+    return { PatchResult::NOT_FOUND, 0 };
+}
+
+// streams the region through engine in chunks of chunk_size, the way scan_step() reads a
+// region that isn't mapped: the bytes kept from the last chunk are followed by the next.
+void engine_scan(TestEntry& entry, u8 number, const std::vector<u8>& region, u64 addr, u32 chunk_size) {
+    auto& patch = entry.patch;
+    for (auto& s : patch.state) {
+        s = {};
+    }
+    patch.active = (1U << patch.rows.size()) - 1;
+
+    std::vector<u8> buffer(entry.patch.automaton.history + chunk_size + VECTOR_SIZE);
+    PendingWrites pending{};
+    ScanContext ctx{ patch, apply_rows, 0, 0, patch.active };
+    ctx.pending = &pending;
+    ScanStream stream{};
+    u32 kept{};
+    for (u32 sz = 0; sz < region.size();) {
+        const auto actual = std::min<u32>(chunk_size, region.size() - sz);
+        std::memcpy(buffer.data() + kept, region.data() + sz, actual);
+        const auto data_size = kept + actual;
+        sz += actual;
+
+        ctx.addr = addr + sz - data_size;
+        engine(number).scan(ctx, buffer.data(), data_size, sz == region.size(), stream);
+
+        const auto keep = std::min(data_size, entry.patch.automaton.history);
+        std::memmove(buffer.data(), buffer.data() + data_size - keep, keep);
+        stream.cursor -= data_size - keep;
+        kept = keep;
+    }
+}
+
+auto random_region(const TestEntry& entry, std::mt19937& rng) -> std::vector<u8> {
+    std::vector<u8> region(200 + rng() % 8000);
+    for (auto& b : region) {
+        // bias towards the bytes the patterns are made of, so partial matches are common.
+        b = rng() % 4 ? rng() : 0x11 * (1 + rng() % 0xE);
+    }
+
+    std::vector<u8> bytes;
+    for (u32 n = region.size() / 64; n; n--) {
+        bytes.clear();
+        instance_of(entry.strings[rng() % entry.strings.size()], rng, bytes);
+        if (rng() % 8 == 0) {
+            bytes[rng() % bytes.size()] ^= 1 << rng() % 8;
+        }
+        // any start, so that plenty of matches put the instruction off alignment.
+        const auto at = rng() % region.size();
+        std::memcpy(region.data() + at, bytes.data(), std::min<u32>(bytes.size(), region.size() - at));
+    }
+    return region;
+}
+
+void test_engines() {
+    std::mt19937 rng(1);
+    u32 found[std::size(entries)][MAX_PATTERNS_PER_TITLE]{};
+    for (u32 it = 0; it < 600; it++) {
+        for (u32 e = 0; e < std::size(entries); e++) {
+            auto& entry = entries[e];
+            const auto region = random_region(entry, rng);
+            const u64 addr = 0x7100000000 + rng() % 8;
+            const u32 chunk_size = 32 + rng() % 1500;
+
+            Found expected[MAX_PATTERNS_PER_TITLE];
+            for (u32 row = 0; row < entry.patterns.size(); row++) {
+                expected[row] = baseline_scan(entry, region, addr, row);
+                found[e][row] += expected[row].result != PatchResult::NOT_FOUND;
+            }
+
+            for (u8 number = 1; number <= std::size(ENGINES); number++) {
+                engine_scan(entry, number, region, addr, chunk_size);
+                for (u32 row = 0; row < entry.patterns.size(); row++) {
+                    const auto& s = entry.patch.state[row];
+                    const auto same = s.result == expected[row].result &&
+                        (s.result == PatchResult::NOT_FOUND || s.logged_offset == expected[row].logged_offset);
+                    if (!same && failed < 20) {
+                        std::printf("%s engine, row %s: got %d at 0x%llx, expected %d at 0x%llx (size %zu, chunk %u)\n",
+                            engine(number).name, entry.patterns[row].patch_name, int(s.result), (unsigned long long)s.logged_offset,
+                            int(expected[row].result), (unsigned long long)expected[row].logged_offset, region.size(), chunk_size);
+                    }
+                    CHECK(same);
+                }
+            }
+        }
+    }
+
+    // every row has to be found now and then, else the test says little about it.
+    for (u32 e = 0; e < std::size(entries); e++) {
+        for (u32 row = 0; row < entries[e].patterns.size(); row++) {
+            CHECK(found[e][row] > 0);
+        }
+    }
+}
+
+// a match that puts the instruction off alignment doesn't count towards match_index,
+// the baseline used to count it.
+void test_unaligned_match() {
+    auto& entry = entries[0];
+    std::vector<u8> region(64);
+    const u8 pattern[] = { 0x11, 0x22, 0x33, 0x44 };
+    std::memcpy(region.data() + 1, pattern, sizeof(pattern));
+    std::memcpy(region.data() + 16, pattern, sizeof(pattern));
+
+    for (u8 number = 1; number <= std::size(ENGINES); number++) {
+        engine_scan(entry, number, region, 0x7100000000, 32);
+        CHECK(entry.patch.state[0].result == PatchResult::PATCHED_SYSPATCH);
+        CHECK(entry.patch.state[0].logged_offset == 0x7100000000 + 16);
+    }
+}
+
+} // namespace
+
+int main() {
+    test_engines();
+    test_unaligned_match();
+
+    if (failed) {
+        std::printf("scan_test: %d checks failed\n", failed);
+        return 1;
+    }
+    std::printf("scan_test: ok\n");
+}